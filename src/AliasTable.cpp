@@ -0,0 +1,73 @@
+#include "AliasTable.h"
+
+// STL
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+AliasTable::AliasTable(const std::vector<float>& weights)
+    : bins_(weights.size())
+    , probabilities_(weights.size(), 0.0F) {
+  if (weights.empty()) {
+    return;
+  }
+
+  for (const float weight : weights) {
+    total_weight_ += std::max(weight, 0.0F);
+  }
+
+  // Degenerate distributions fall back to uniform
+  const std::size_t count{ weights.size() };
+  const double uniform_weight{ 1.0 / static_cast<double>(count) };
+  std::vector<double> scaled(count);
+  for (std::size_t i{ 0U }; i < count; ++i) {
+    const double probability{
+      total_weight_ > 0.0
+        ? static_cast<double>(std::max(weights[i], 0.0F)) / total_weight_
+        : uniform_weight
+    };
+    probabilities_[i] = static_cast<float>(probability);
+    scaled[i] = probability * static_cast<double>(count);
+  }
+
+  // Partition into under- and overfull bins
+  std::vector<std::uint32_t> small{};
+  std::vector<std::uint32_t> large{};
+  for (std::size_t i{ 0U }; i < count; ++i) {
+    (scaled[i] < 1.0 ? small : large).emplace_back(static_cast<std::uint32_t>(i));
+  }
+
+  // Fill each underfull bin with the excess of an overfull one
+  while (!small.empty() && !large.empty()) {
+    const std::uint32_t under{ small.back() };
+    small.pop_back();
+    const std::uint32_t over{ large.back() };
+
+    bins_[under] = Bin{ static_cast<float>(scaled[under]), over };
+    scaled[over] -= 1.0 - scaled[under];
+    if (scaled[over] < 1.0) {
+      large.pop_back();
+      small.emplace_back(over);
+    }
+  }
+
+  // Remaining bins are full up to rounding error
+  for (const std::uint32_t index : large) {
+    bins_[index] = Bin{ 1.0F, index };
+  }
+  for (const std::uint32_t index : small) {
+    bins_[index] = Bin{ 1.0F, index };
+  }
+}
+
+std::size_t AliasTable::Sample(float u) const noexcept {
+  // Split u into a bin index and a uniform remainder for the coin flip
+  const float scaled{ u * static_cast<float>(bins_.size()) };
+  const std::size_t index{
+    std::min(static_cast<std::size_t>(scaled), bins_.size() - 1U)
+  };
+  const float remainder{ scaled - static_cast<float>(index) };
+
+  return remainder < bins_[index].threshold ? index : bins_[index].alias;
+}
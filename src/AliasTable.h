@@ -0,0 +1,53 @@
+#ifndef ALIASTABLE_H
+#define ALIASTABLE_H
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Walker/Vose alias table for O(1) sampling of a discrete distribution
+class AliasTable {
+public:
+  AliasTable() = default;
+  explicit AliasTable(const std::vector<float>& weights);
+
+  // Picks an index with probability proportional to its weight using a
+  // single uniform number in [0, 1)
+  [[nodiscard]]
+  std::size_t Sample(float u) const noexcept;
+
+  // Normalized probability of picking index
+  [[nodiscard]]
+  float Probability(std::size_t index) const noexcept {
+    return probabilities_[index];
+  }
+
+  [[nodiscard]]
+  std::size_t size() const noexcept {
+    return bins_.size();
+  }
+
+  [[nodiscard]]
+  bool empty() const noexcept {
+    return bins_.empty();
+  }
+
+  // Sum of the weights the table was built from
+  [[nodiscard]]
+  double total_weight() const noexcept {
+    return total_weight_;
+  }
+
+private:
+  struct Bin {
+    float threshold;
+    std::uint32_t alias;
+  };
+
+  std::vector<Bin> bins_;
+  std::vector<float> probabilities_;
+  double total_weight_{ 0.0 };
+};
+
+#endif
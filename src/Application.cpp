@@ -1,11 +1,24 @@
 #include "Application.h"
 
 // STL
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 // glad
 #include "glad/gl.h"
 
+// glm
+#include "glm/vec3.hpp"
+
 // spdlog
 #include "spdlog/spdlog.h"
 
@@ -18,6 +31,101 @@
 #include "imgui_impl_sdl3.h"
 #include "imgui_impl_opengl3.h"
 
+// src
+#include "JobSystem.h"
+#include "LogRing.h"
+#include "PreviewRenderer.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "SceneLoader.h"
+#include "Sphere.h"
+
+namespace {
+
+// Part of each 16 ms frame spent refining previews; the rest is left for
+// building the GUI and swapping buffers
+constexpr std::chrono::milliseconds kPreviewFrameBudget{ 12 };
+
+// Scene view camera speed in units per second
+constexpr float kSceneCameraSpeed{ 2.0F };
+
+// Oldest Console lines are discarded beyond this many
+constexpr std::size_t kMaxConsoleLines{ 100000U };
+
+// Hierarchy filter jobs check for a newer query every this many spheres
+constexpr std::size_t kHierarchyFilterCheckInterval{ 4096U };
+
+// Smallest radius the Inspector allows
+constexpr float kMinSphereRadius{ 0.001F };
+
+// Edited spheres re-render the tiles within this many radii by default,
+// catching nearby shadows as well as the sphere itself
+constexpr float kDefaultDirtyRegionWidening{ 2.0F };
+constexpr float kMaxDirtyRegionWidening{ 20.0F };
+
+// Lower-cased terms of a filter query in ImGuiTextFilter's syntax:
+// comma separated, with a leading '-' excluding matches. Matching is done
+// here rather than with ImGuiTextFilter because that allocates through
+// the GUI context, which must not be touched off the main thread.
+struct FilterTerms {
+  std::vector<std::string> included;
+  std::vector<std::string> excluded;
+};
+
+void ToLowerAscii(std::string& text) {
+  for (char& character : text) {
+    if (character >= 'A' && character <= 'Z') {
+      character = static_cast<char>(character - 'A' + 'a');
+    }
+  }
+}
+
+FilterTerms ParseFilterTerms(std::string_view query) {
+  FilterTerms terms{};
+  while (!query.empty()) {
+    const std::size_t comma{ std::min(query.find(','), query.size()) };
+    std::string_view term{ query.substr(0U, comma) };
+    query.remove_prefix(std::min(comma + 1U, query.size()));
+
+    const std::size_t begin{ term.find_first_not_of(' ') };
+    if (begin == std::string_view::npos) {
+      continue;
+    }
+    term = term.substr(begin, term.find_last_not_of(' ') + 1U - begin);
+
+    const bool excluded{ term.front() == '-' };
+    std::string lowered{ excluded ? term.substr(1U) : term };
+    ToLowerAscii(lowered);
+    if (!lowered.empty()) {
+      (excluded ? terms.excluded : terms.included).emplace_back(std::move(lowered));
+    }
+  }
+  return terms;
+}
+
+// Whether a lower-cased label contains no excluded term and, if there
+// are any, at least one included term
+bool PassesFilterTerms(const FilterTerms& terms, std::string_view label) {
+  const auto contains = [label](const std::string& term) {
+    return label.find(term) != std::string_view::npos;
+  };
+  return std::ranges::none_of(terms.excluded, contains)
+         && (terms.included.empty() || std::ranges::any_of(terms.included, contains));
+}
+
+// Label of a sphere in the Hierarchy: its name, or if unnamed its
+// position in the scene file, as building the scene reorders spheres
+void FormatSphereLabel(const Scene& scene, std::size_t index, std::string& label) {
+  const std::string_view name{ scene.sphere_name(index) };
+  if (name.empty()) {
+    label = "Sphere " + std::to_string(scene.sphere_source_index(index));
+  } else {
+    label.assign(name);
+  }
+}
+
+}  // namespace
+
 Application::Application()
     : platform_initialized_{ false }
     , window_{ nullptr, nullptr }
@@ -32,7 +140,37 @@ Application::Application()
     , show_rtiow_window_{ true }
     , show_project_window_{ true }
     , show_console_window_{ true }
-    , show_scene_window_{ true } {}
+    , show_scene_window_{ true }
+    , show_game_window_{ true }
+    , scene_{ std::make_shared<Scene>() }
+    , scene_load_{ nullptr }
+    , jobs_{ std::make_unique<JobSystem>() }
+    , scene_view_{ std::make_unique<PreviewRenderer>(RenderSettings{}), 0U, false }
+    , game_view_{ std::make_unique<PreviewRenderer>(RenderSettings{}), 0U, false }
+    , console_lines_{}
+    , console_filtered_lines_{}
+    , console_filter_{}
+    , console_min_level_{ spdlog::level::info }
+    , console_auto_scroll_{ true }
+    , hierarchy_scene_{ nullptr }
+    , hierarchy_rows_{}
+    , hierarchy_rows_query_{}
+    , hierarchy_filter_{}
+    , hierarchy_filter_generation_{ 0U }
+    , hierarchy_filter_result_{ nullptr }
+    , hierarchy_filter_pending_{ false }
+    , hierarchy_selection_{}
+    , pending_sphere_edits_{}
+    , dirty_regions_enabled_{ true }
+    , dirty_region_widening_{ kDefaultDirtyRegionWidening } {
+  // Range and select-all requests address rows, which map to spheres
+  hierarchy_selection_.UserData = this;
+  hierarchy_selection_.AdapterIndexToStorageId =
+    [](ImGuiSelectionBasicStorage* selection, int row) {
+      const Application* application{ static_cast<Application*>(selection->UserData) };
+      return static_cast<ImGuiID>(application->hierarchy_rows_[static_cast<std::size_t>(row)]);
+    };
+}
 
 Application::~Application() {
   // Shutdown automatically just in case
@@ -96,6 +234,14 @@ bool Application::Initialize() {
     return false;
   }
 
+  // Create preview textures
+  for (PreviewView* view : { &scene_view_, &game_view_ }) {
+    glGenTextures(1, &view->texture);
+    glBindTexture(GL_TEXTURE_2D, view->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  }
+
   // Create GUI context
   gui_context_ = std::unique_ptr<ImGuiContext,
                                  decltype(&ImGui::DestroyContext)>{
@@ -141,6 +287,10 @@ bool Application::Initialize() {
 void Application::Run() {
   // Main loop
   while (!should_quit_) {
+    const std::chrono::steady_clock::time_point frame_start_time{
+      std::chrono::steady_clock::now()
+    };
+
     // Handle events
     SDL_Event event{};
     while (SDL_PollEvent(&event)) {
@@ -154,6 +304,10 @@ void Application::Run() {
       }
     }
 
+    // Collect messages logged by any thread since the last frame
+    DrainLogRing();
+    UpdateHierarchy();
+
     // Begin new GUI frame
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplSDL3_NewFrame();
@@ -209,6 +363,12 @@ void Application::Run() {
     if (show_scene_window_) { CreateSceneWindow(); }
     if (show_game_window_) { CreateGameWindow(); }
 
+    // Apply this frame's edits before the previews trace the scene again
+    ApplySceneEdits();
+
+    // Refine previews shown by the windows created above
+    UpdatePreviews(frame_start_time);
+
     // Render
     // Clear buffer
     glClearColor(0.0F, 0.0F, 0.0F, 1.0F);
@@ -233,6 +393,24 @@ void Application::Run() {
 }
 
 void Application::Shutdown() {
+  // Stop background jobs first, as they may still publish into the editor.
+  // Queued jobs still run, so make pending Hierarchy filters give up early.
+  if (jobs_) {
+    hierarchy_filter_generation_.fetch_add(1U);
+    jobs_.reset();
+    spdlog::info("Editor background jobs stopped.");
+  }
+
+  // Delete preview textures while their renderer context still exists
+  if (renderer_context_) {
+    for (PreviewView* view : { &scene_view_, &game_view_ }) {
+      if (view->texture != 0U) {
+        glDeleteTextures(1, &view->texture);
+        view->texture = 0U;
+      }
+    }
+  }
+
   // Shutdown GUI for renderer
   if (gui_renderer_initialized_) {
     ImGui_ImplOpenGL3_Shutdown();
@@ -273,6 +451,46 @@ void Application::Shutdown() {
   }
 }
 
+void Application::LoadSceneAsync(const std::filesystem::path& path) {
+  if (!jobs_) {
+    return;
+  }
+
+  // Publish the load first so its progress is visible immediately
+  std::shared_ptr<SceneLoad> scene_load{ std::make_shared<SceneLoad>() };
+  scene_load->path = path;
+  scene_load_.store(scene_load);
+  spdlog::info("Loading scene {} in the background.", path.string());
+
+  // Parse and build on the job system, then swap the finished scene in
+  // for the renderer in a single atomic store
+  JobSystem* jobs{ jobs_.get() };
+  jobs->Submit([this, jobs, scene_load = std::move(scene_load)]() {
+    std::shared_ptr<Scene> scene{
+      LoadScene(scene_load->path, jobs, &scene_load->progress)
+    };
+    if (scene) {
+      scene_.store(std::move(scene));
+    }
+  });
+}
+
+void SDLCALL Application::OnOpenSceneDialogClosed(
+    void* userdata,
+    const char* const* file_list,
+    int filter) {
+  // May be called from a thread other than the main one
+  if (!file_list) {
+    spdlog::error(SDL_GetError());
+    return;
+  }
+  if (!file_list[0]) {
+    return;
+  }
+
+  static_cast<Application*>(userdata)->LoadSceneAsync(file_list[0]);
+}
+
 void Application::OnQuit() {
   should_quit_ = true;
 }
@@ -299,6 +517,14 @@ void Application::CreateMainMenuBar() {
         // ???
       }
       ImGui::Separator();
+      if (ImGui::MenuItem("Open Scene...")) {
+        static constexpr SDL_DialogFileFilter scene_filters[]{
+          { "RTIOW scenes", "rtscene" }
+        };
+        SDL_ShowOpenFileDialog(OnOpenSceneDialogClosed, this, window_.get(),
+                               scene_filters, 1, nullptr, false);
+      }
+      ImGui::Separator();
       if (ImGui::MenuItem("Exit")) {
         should_quit_ = true;
       }
@@ -399,21 +625,63 @@ void Application::SetupDefaultEditorDockSpaceLayout(ImGuiID dock_space_id) {
 
 void Application::CreateHierarchyWindow() {
   if (ImGui::Begin("Hierarchy", &show_hierarchy_window_)) {
-    // ???
+    // Refilter in the background, keeping the old rows until it is done
+    if (hierarchy_filter_.Draw("Filter", -50.0F)) {
+      StartHierarchyFilter();
+    }
+    const std::size_t sphere_count{ hierarchy_scene_ ? hierarchy_scene_->sphere_count() : 0U };
+    if (hierarchy_filter_pending_) {
+      ImGui::Text("Filtering %zu spheres...", sphere_count);
+    } else {
+      ImGui::Text("%zu of %zu spheres", hierarchy_rows_.size(), sphere_count);
+    }
+    ImGui::Separator();
+
+    CreateHierarchyRows();
   }
   ImGui::End();
 }
 
 void Application::CreateInspectorWindow() {
   if (ImGui::Begin("Inspector", &show_inspector_window_)) {
-    // ???
+    // Show the first selected sphere; edits apply to the whole selection
+    void* iterator{ nullptr };
+    ImGuiID sphere{};
+    if (hierarchy_scene_ && hierarchy_selection_.GetNextSelectedItem(&iterator, &sphere)) {
+      CreateSphereInspector(sphere);
+    } else {
+      ImGui::TextDisabled("Select spheres in the Hierarchy to edit them.");
+    }
   }
   ImGui::End();
 }
 
 void Application::CreateRtiowWindow() {
   if (ImGui::Begin("RTIOW", &show_rtiow_window_)) {
-    // ???
+    // Summarize the scene currently being rendered
+    const std::shared_ptr<const Scene> scene{ scene_.load() };
+    ImGui::Text("Spheres: %zu", scene->sphere_count());
+    ImGui::Text("Lights: %zu", scene->light_tree().size());
+
+    // Report how far the scene preview has been refined
+    const PreviewRenderer& preview{ *scene_view_.renderer };
+    if (preview.converged()) {
+      ImGui::Text("Preview: converged");
+    } else {
+      ImGui::Text("Preview: 1/%zu resolution", preview.current_stride());
+    }
+    ImGui::Text("Preview rate: %.2f Msamples/s", preview.samples_per_second() * 1.0e-6);
+
+    // Edits re-render only around the edited spheres unless disabled,
+    // e.g. when they visibly change lighting farther away
+    ImGui::Checkbox("Re-render edited regions only", &dirty_regions_enabled_);
+    ImGui::BeginDisabled(!dirty_regions_enabled_);
+    ImGui::SliderFloat("Region widening", &dirty_region_widening_,
+                       1.0F, kMaxDirtyRegionWidening, "%.1fx radius",
+                       ImGuiSliderFlags_AlwaysClamp);
+    ImGui::EndDisabled();
+
+    CreateSceneLoadProgressBar();
   }
   ImGui::End();
 }
@@ -427,21 +695,459 @@ void Application::CreateProjectWindow() {
 
 void Application::CreateConsoleWindow() {
   if (ImGui::Begin("Console", &show_console_window_)) {
-    // ???
+    CreateSceneLoadProgressBar();
+
+    // Filter by minimum level and text
+    bool filter_changed{ false };
+    if (ImGui::Button("Clear")) {
+      console_lines_.clear();
+      console_filtered_lines_.clear();
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Auto-scroll", &console_auto_scroll_);
+    ImGui::SameLine();
+    static constexpr const char* level_names[]{
+      "Trace", "Debug", "Info", "Warning", "Error", "Critical"
+    };
+    ImGui::SetNextItemWidth(100.0F);
+    filter_changed |= ImGui::Combo("Level", &console_min_level_,
+                                   level_names, IM_ARRAYSIZE(level_names));
+    ImGui::SameLine();
+    filter_changed |= console_filter_.Draw("Filter", -50.0F);
+    if (filter_changed) {
+      RebuildConsoleFilter();
+    }
+    ImGui::Separator();
+
+    CreateConsoleLines();
   }
   ImGui::End();
 }
 
 void Application::CreateSceneWindow() {
   if (ImGui::Begin("Scene", &show_scene_window_)) {
-    // ???
+    UpdateSceneCamera();
+    CreatePreviewImage(scene_view_);
   }
   ImGui::End();
 }
 
 void Application::CreateGameWindow() {
   if (ImGui::Begin("Game", &show_game_window_)) {
-    // ???
+    CreatePreviewImage(game_view_);
   }
   ImGui::End();
 }
+
+void Application::CreateSceneLoadProgressBar() const {
+  const std::shared_ptr<const SceneLoad> scene_load{ scene_load_.load() };
+  if (!scene_load) {
+    return;
+  }
+
+  // Show the stage of the most recent load and how far along it is
+  const SceneLoadStage stage{
+    scene_load->progress.stage.load(std::memory_order_acquire)
+  };
+  const float fraction{
+    scene_load->progress.fraction.load(std::memory_order_relaxed)
+  };
+  const std::string label{
+    std::string{ ToString(stage) } + " " + scene_load->path.filename().string()
+  };
+  ImGui::ProgressBar(fraction, ImVec2{ -1.0F, 0.0F }, label.c_str());
+}
+
+void Application::CreatePreviewImage(PreviewView& view) {
+  // Render at the size of the window's content region
+  const ImVec2 size{ ImGui::GetContentRegionAvail() };
+  if (size.x < 1.0F || size.y < 1.0F) {
+    return;
+  }
+
+  RenderSettings settings{ view.renderer->settings() };
+  settings.image_width = static_cast<std::size_t>(size.x);
+  settings.image_height = static_cast<std::size_t>(size.y);
+  view.renderer->SetSettings(settings);
+  view.visible = true;
+
+  // The texture is refreshed after all windows are created, before drawing
+  ImGui::Image(static_cast<ImTextureID>(view.texture), size);
+}
+
+void Application::UpdateSceneCamera() {
+  const bool focused{ ImGui::IsWindowFocused() };
+  const bool hovered{ ImGui::IsWindowHovered() };
+  if (!focused && !hovered) {
+    return;
+  }
+
+  const ImGuiIO& io{ ImGui::GetIO() };
+  RenderSettings settings{ scene_view_.renderer->settings() };
+
+  // Fly with WASD, and QE for down and up
+  if (focused) {
+    const float step{ kSceneCameraSpeed * io.DeltaTime };
+    if (ImGui::IsKeyDown(ImGuiKey_W)) { settings.camera_position.z -= step; }
+    if (ImGui::IsKeyDown(ImGuiKey_S)) { settings.camera_position.z += step; }
+    if (ImGui::IsKeyDown(ImGuiKey_A)) { settings.camera_position.x -= step; }
+    if (ImGui::IsKeyDown(ImGuiKey_D)) { settings.camera_position.x += step; }
+    if (ImGui::IsKeyDown(ImGuiKey_Q)) { settings.camera_position.y -= step; }
+    if (ImGui::IsKeyDown(ImGuiKey_E)) { settings.camera_position.y += step; }
+  }
+
+  // Pan by dragging with the right mouse button, one pixel per pixel
+  // on the focal plane
+  if (hovered && ImGui::IsMouseDragging(ImGuiMouseButton_Right)) {
+    const float units_per_pixel{
+      settings.viewport_height
+      / static_cast<float>(std::max<std::size_t>(settings.image_height, 1U))
+    };
+    settings.camera_position.x -= io.MouseDelta.x * units_per_pixel;
+    settings.camera_position.y += io.MouseDelta.y * units_per_pixel;
+  }
+
+  scene_view_.renderer->SetSettings(settings);
+}
+
+void Application::UpdatePreviews(
+    std::chrono::steady_clock::time_point frame_start_time) {
+  if (!jobs_) {
+    return;
+  }
+
+  // Split what is left of the budget evenly between visible previews
+  const std::shared_ptr<const Scene> scene{ scene_.load() };
+  const std::chrono::steady_clock::time_point deadline{
+    frame_start_time + kPreviewFrameBudget
+  };
+  PreviewView* const views[]{ &scene_view_, &game_view_ };
+  std::size_t visible_view_count{
+    static_cast<std::size_t>(std::ranges::count_if(views, [](const PreviewView* view) {
+      return view->visible;
+    }))
+  };
+
+  for (PreviewView* view : views) {
+    if (!view->visible) {
+      continue;
+    }
+    view->visible = false;
+
+    const std::chrono::nanoseconds remaining_time{
+      std::max(std::chrono::nanoseconds{ 0 },
+               std::chrono::nanoseconds{ deadline - std::chrono::steady_clock::now() })
+    };
+    const std::chrono::nanoseconds budget{
+      remaining_time / static_cast<std::chrono::nanoseconds::rep>(visible_view_count)
+    };
+    --visible_view_count;
+
+    // Upload the display image if any samples were added
+    if (view->renderer->Render(scene, *jobs_, budget)) {
+      const RenderSettings& settings{ view->renderer->settings() };
+      glBindTexture(GL_TEXTURE_2D, view->texture);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
+                   static_cast<GLsizei>(settings.image_width),
+                   static_cast<GLsizei>(settings.image_height),
+                   0, GL_RGBA, GL_UNSIGNED_BYTE,
+                   view->renderer->display().data());
+    }
+  }
+}
+
+void Application::CreateConsoleLines() {
+  if (ImGui::BeginChild("ConsoleLines", ImVec2{ 0.0F, 0.0F },
+                        ImGuiChildFlags_None, ImGuiWindowFlags_HorizontalScrollbar)) {
+    // Only submit the lines scrolled into view
+    ImGuiListClipper clipper{};
+    clipper.Begin(static_cast<int>(console_filtered_lines_.size()));
+    while (clipper.Step()) {
+      for (int i{ clipper.DisplayStart }; i < clipper.DisplayEnd; ++i) {
+        const ConsoleLine& line{
+          console_lines_[console_filtered_lines_[static_cast<std::size_t>(i)]]
+        };
+
+        // Highlight warnings and errors
+        bool has_color{ true };
+        if (line.level >= spdlog::level::err) {
+          ImGui::PushStyleColor(ImGuiCol_Text, ImVec4{ 1.0F, 0.4F, 0.4F, 1.0F });
+        } else if (line.level == spdlog::level::warn) {
+          ImGui::PushStyleColor(ImGuiCol_Text, ImVec4{ 1.0F, 0.8F, 0.4F, 1.0F });
+        } else {
+          has_color = false;
+        }
+        ImGui::TextUnformatted(line.text.data(), line.text.data() + line.text.size());
+        if (has_color) {
+          ImGui::PopStyleColor();
+        }
+      }
+    }
+    clipper.End();
+
+    // Keep following new lines while scrolled to the bottom
+    if (console_auto_scroll_ && ImGui::GetScrollY() >= ImGui::GetScrollMaxY()) {
+      ImGui::SetScrollHereY(1.0F);
+    }
+  }
+  ImGui::EndChild();
+}
+
+void Application::CreateHierarchyRows() {
+  if (ImGui::BeginChild("HierarchyRows")) {
+    constexpr ImGuiMultiSelectFlags multi_select_flags{
+      ImGuiMultiSelectFlags_ClearOnEscape
+      | ImGuiMultiSelectFlags_ClearOnClickVoid
+      | ImGuiMultiSelectFlags_BoxSelect1d
+    };
+    const int row_count{ static_cast<int>(hierarchy_rows_.size()) };
+    ImGuiMultiSelectIO* multi_select{
+      ImGui::BeginMultiSelect(multi_select_flags, hierarchy_selection_.Size, row_count)
+    };
+    hierarchy_selection_.ApplyRequests(multi_select);
+
+    // Only submit the rows scrolled into view, plus the row a range
+    // selection starts from so shift-clicks can reach it
+    ImGuiListClipper clipper{};
+    clipper.Begin(row_count);
+    if (multi_select->RangeSrcItem >= 0 && multi_select->RangeSrcItem < row_count) {
+      clipper.IncludeItemByIndex(static_cast<int>(multi_select->RangeSrcItem));
+    }
+    std::string label{};
+    while (clipper.Step()) {
+      for (int i{ clipper.DisplayStart }; i < clipper.DisplayEnd; ++i) {
+        const std::uint32_t sphere{ hierarchy_rows_[static_cast<std::size_t>(i)] };
+        FormatSphereLabel(*hierarchy_scene_, sphere, label);
+
+        ImGui::PushID(static_cast<int>(sphere));
+        ImGui::SetNextItemSelectionUserData(i);
+        ImGui::Selectable(label.c_str(), hierarchy_selection_.Contains(sphere));
+        ImGui::PopID();
+      }
+    }
+    clipper.End();
+
+    multi_select = ImGui::EndMultiSelect();
+    hierarchy_selection_.ApplyRequests(multi_select);
+  }
+  ImGui::EndChild();
+}
+
+void Application::CreateSphereInspector(std::size_t index) {
+  const Sphere sphere{ hierarchy_scene_->GetSphere(index) };
+  std::string label{};
+  FormatSphereLabel(*hierarchy_scene_, index, label);
+  if (hierarchy_selection_.Size > 1) {
+    ImGui::Text("%s and %d more", label.c_str(), hierarchy_selection_.Size - 1);
+  } else {
+    ImGui::TextUnformatted(label.c_str());
+  }
+  ImGui::Separator();
+
+  glm::vec3 center{ sphere.center() };
+  float radius{ sphere.radius() };
+  Material material{ sphere.material() };
+  const bool center_changed{ ImGui::DragFloat3("Center", &center.x, 0.01F) };
+  const bool radius_changed{
+    ImGui::DragFloat("Radius", &radius, 0.01F,
+                     kMinSphereRadius, std::numeric_limits<float>::max(),
+                     "%.3f", ImGuiSliderFlags_AlwaysClamp)
+  };
+  const bool albedo_changed{ ImGui::ColorEdit3("Albedo", &material.albedo.x) };
+  const bool emission_changed{
+    ImGui::ColorEdit3("Emission", &material.emission.x,
+                      ImGuiColorEditFlags_HDR | ImGuiColorEditFlags_Float)
+  };
+  if (!center_changed && !radius_changed && !albedo_changed && !emission_changed) {
+    return;
+  }
+
+  // Change only the edited property of each selected sphere, moving them
+  // all by the same offset
+  const glm::vec3 offset{ center - sphere.center() };
+  void* iterator{ nullptr };
+  ImGuiID selected_sphere{};
+  while (hierarchy_selection_.GetNextSelectedItem(&iterator, &selected_sphere)) {
+    const Sphere selected{ hierarchy_scene_->GetSphere(selected_sphere) };
+    Material selected_material{ selected.material() };
+    if (albedo_changed) {
+      selected_material.albedo = material.albedo;
+    }
+    if (emission_changed) {
+      selected_material.emission = material.emission;
+    }
+    pending_sphere_edits_.emplace_back(SphereEdit{
+      selected_sphere,
+      Sphere{ selected.center() + offset,
+              radius_changed ? radius : selected.radius(),
+              selected_material }
+    });
+  }
+}
+
+void Application::UpdateHierarchy() {
+  // List a newly loaded scene from scratch
+  const std::shared_ptr<Scene> scene{ scene_.load() };
+  if (scene != hierarchy_scene_) {
+    hierarchy_scene_ = scene;
+    hierarchy_rows_.clear();
+    hierarchy_rows_query_.clear();
+    hierarchy_selection_.Clear();
+    StartHierarchyFilter();
+  }
+
+  // Show the rows of the newest query once they are ready
+  const std::shared_ptr<HierarchyFilterResult> result{ hierarchy_filter_result_.load() };
+  if (hierarchy_filter_pending_ && result
+      && result->generation == hierarchy_filter_generation_.load()) {
+    hierarchy_rows_ = std::move(result->rows);
+    hierarchy_rows_query_ = std::move(result->query);
+    hierarchy_filter_pending_ = false;
+  }
+}
+
+void Application::StartHierarchyFilter() {
+  if (!jobs_ || !hierarchy_scene_) {
+    return;
+  }
+
+  const std::uint64_t generation{ hierarchy_filter_generation_.fetch_add(1U) + 1U };
+  hierarchy_filter_pending_ = true;
+  std::string query{ hierarchy_filter_.InputBuf };
+
+  // Extending a single search term can only drop rows, so only the rows
+  // of the previous query need checking again; alternatives (',') and
+  // exclusions ('-') can add rows back
+  std::vector<std::uint32_t> candidates{};
+  const bool narrows_rows{
+    !hierarchy_rows_query_.empty() && query.starts_with(hierarchy_rows_query_)
+    && query.find_first_of(",-") == std::string::npos
+  };
+  if (narrows_rows) {
+    candidates = hierarchy_rows_;
+  }
+
+  // Match labels on the job system, giving up once a newer query starts
+  jobs_->Submit([this, generation, narrows_rows,
+                 scene = hierarchy_scene_,
+                 query = std::move(query),
+                 candidates = std::move(candidates)]() mutable {
+    const FilterTerms terms{ ParseFilterTerms(query) };
+    const std::size_t count{ narrows_rows ? candidates.size() : scene->sphere_count() };
+    std::vector<std::uint32_t> rows{};
+    std::string label{};
+    for (std::size_t i{ 0U }; i < count; ++i) {
+      if (i % kHierarchyFilterCheckInterval == 0U
+          && hierarchy_filter_generation_.load() != generation) {
+        return;
+      }
+
+      const std::uint32_t sphere{
+        narrows_rows ? candidates[i] : static_cast<std::uint32_t>(i)
+      };
+      FormatSphereLabel(*scene, sphere, label);
+      ToLowerAscii(label);
+      if (PassesFilterTerms(terms, label)) {
+        rows.emplace_back(sphere);
+      }
+    }
+
+    // Publish unless a newer query has already published its rows
+    std::shared_ptr<HierarchyFilterResult> result{
+      std::make_shared<HierarchyFilterResult>(
+        HierarchyFilterResult{ generation, std::move(query), std::move(rows) })
+    };
+    std::shared_ptr<HierarchyFilterResult> published{ hierarchy_filter_result_.load() };
+    while ((!published || published->generation < generation)
+           && !hierarchy_filter_result_.compare_exchange_weak(published, result)) {
+    }
+  });
+}
+
+void Application::ApplySceneEdits() {
+  if (pending_sphere_edits_.empty()) {
+    return;
+  }
+
+  // Edits refer to the listed scene; drop them if another one was loaded
+  // meanwhile. Previews only trace during UpdatePreviews(), so the scene
+  // can be changed in place here.
+  const std::shared_ptr<Scene> scene{ scene_.load() };
+  if (!scene || scene != hierarchy_scene_) {
+    pending_sphere_edits_.clear();
+    return;
+  }
+
+  // Collect where each sphere was and now is, widened to cover nearby
+  // lighting changes. Editing a light changes lighting everywhere, so
+  // that re-renders the whole image.
+  bool full_invalidation{ !dirty_regions_enabled_ };
+  std::vector<Sphere> dirty_bounds{};
+  for (const SphereEdit& edit : pending_sphere_edits_) {
+    if (full_invalidation || edit.index >= scene->sphere_count()) {
+      continue;
+    }
+    const Sphere previous{ scene->GetSphere(edit.index) };
+    for (const Sphere* sphere : { &previous, &edit.sphere }) {
+      const glm::vec3& emission{ sphere->material().emission };
+      full_invalidation |= emission.r > 0.0F || emission.g > 0.0F || emission.b > 0.0F;
+      dirty_bounds.emplace_back(sphere->center(), sphere->radius() * dirty_region_widening_);
+    }
+  }
+
+  scene->UpdateSpheres(pending_sphere_edits_);
+  pending_sphere_edits_.clear();
+  for (PreviewView* view : { &scene_view_, &game_view_ }) {
+    if (full_invalidation) {
+      view->renderer->InvalidateScene();
+    } else {
+      view->renderer->InvalidateSpheres(dirty_bounds);
+    }
+  }
+}
+
+void Application::DrainLogRing() {
+  LogRing& ring{ GetLogRing() };
+  LogEntry entry{};
+  while (ring.TryPop(entry)) {
+    AddConsoleLine(entry.level, FormatLogEntry(entry));
+  }
+
+  // Report messages lost to a full ring
+  const std::size_t dropped_count{ ring.TakeDroppedCount() };
+  if (dropped_count > 0U) {
+    AddConsoleLine(spdlog::level::warn,
+                   "Dropped " + std::to_string(dropped_count) + " log messages.");
+  }
+
+  // Bound memory by discarding the oldest quarter of the lines
+  if (console_lines_.size() > kMaxConsoleLines) {
+    console_lines_.erase(
+      console_lines_.begin(),
+      console_lines_.begin() + static_cast<std::ptrdiff_t>(kMaxConsoleLines / 4U)
+    );
+    RebuildConsoleFilter();
+  }
+}
+
+void Application::AddConsoleLine(spdlog::level::level_enum level, std::string text) {
+  console_lines_.emplace_back(ConsoleLine{ level, std::move(text) });
+  if (PassesConsoleFilter(console_lines_.back())) {
+    console_filtered_lines_.emplace_back(console_lines_.size() - 1U);
+  }
+}
+
+void Application::RebuildConsoleFilter() {
+  console_filtered_lines_.clear();
+  for (std::size_t i{ 0U }; i < console_lines_.size(); ++i) {
+    if (PassesConsoleFilter(console_lines_[i])) {
+      console_filtered_lines_.emplace_back(i);
+    }
+  }
+}
+
+bool Application::PassesConsoleFilter(const ConsoleLine& line) const {
+  return static_cast<int>(line.level) >= console_min_level_
+         && console_filter_.PassFilter(line.text.data(),
+                                       line.text.data() + line.text.size());
+}
@@ -2,7 +2,17 @@
 #define APPLICATION_H
 
 // STL
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <memory>
+#include <string>
+#include <vector>
+
+// spdlog
+#include "spdlog/common.h"
 
 // SDL
 #include "SDL3/SDL.h"
@@ -10,6 +20,15 @@
 // imgui
 #include "imgui.h"
 
+// src
+#include "SceneLoader.h"
+
+// Forward declarations
+class JobSystem;
+class PreviewRenderer;
+class Scene;
+struct SphereEdit;
+
 class Application {
 public:
   Application();
@@ -19,7 +38,42 @@ public:
   void Run();
   void Shutdown();
 
+  // Loads a scene on the job system and publishes it once built;
+  // safe to call from any thread
+  void LoadSceneAsync(const std::filesystem::path& path);
+
 private:
+  // A scene load in flight, or the last one that finished
+  struct SceneLoad {
+    std::filesystem::path path;
+    SceneLoadProgress progress;
+  };
+
+  // Progressive render shown in the Scene or Game window
+  struct PreviewView {
+    std::unique_ptr<PreviewRenderer> renderer;
+    unsigned int texture;
+    bool visible;
+  };
+
+  // Log message shown in the Console
+  struct ConsoleLine {
+    spdlog::level::level_enum level;
+    std::string text;
+  };
+
+  // Spheres matching a Hierarchy filter query, found by a background job
+  struct HierarchyFilterResult {
+    std::uint64_t generation;
+    std::string query;
+    std::vector<std::uint32_t> rows;
+  };
+
+  static void SDLCALL OnOpenSceneDialogClosed(
+    void* userdata,
+    const char* const* file_list,
+    int filter);
+
   void OnQuit();
   void OnWindowResized() const;
 
@@ -35,6 +89,34 @@ private:
   void CreateSceneWindow();
   void CreateGameWindow();
 
+  void CreateSceneLoadProgressBar() const;
+  void CreateConsoleLines();
+  void CreateHierarchyRows();
+  void CreateSphereInspector(std::size_t index);
+  void CreatePreviewImage(PreviewView& view);
+
+  // Follows the scene being rendered and picks up finished filter results
+  void UpdateHierarchy();
+  // Filters the Hierarchy's rows by the current query on the job system
+  void StartHierarchyFilter();
+
+  // Applies the edits made during the frame as one scene update
+  void ApplySceneEdits();
+
+  // Moves the scene view's camera from keyboard and mouse input
+  void UpdateSceneCamera();
+
+  // Moves messages logged since the last frame into the Console
+  void DrainLogRing();
+  void AddConsoleLine(spdlog::level::level_enum level, std::string text);
+  void RebuildConsoleFilter();
+
+  [[nodiscard]]
+  bool PassesConsoleFilter(const ConsoleLine& line) const;
+
+  // Refines visible previews until the frame's time budget runs out
+  void UpdatePreviews(std::chrono::steady_clock::time_point frame_start_time);
+
 private:
   bool platform_initialized_;
   std::unique_ptr<SDL_Window,
@@ -56,6 +138,42 @@ private:
   bool show_console_window_;
   bool show_scene_window_;
   bool show_game_window_;
+
+  // Scene the renderer draws; replaced atomically when a load finishes,
+  // and edited in place between frames while no preview is tracing it
+  std::atomic<std::shared_ptr<Scene>> scene_;
+  std::atomic<std::shared_ptr<SceneLoad>> scene_load_;
+  std::unique_ptr<JobSystem> jobs_;
+
+  PreviewView scene_view_;
+  PreviewView game_view_;
+
+  std::vector<ConsoleLine> console_lines_;
+  // Indices of the lines passing the filter, in order
+  std::vector<std::size_t> console_filtered_lines_;
+  ImGuiTextFilter console_filter_;
+  int console_min_level_;
+  bool console_auto_scroll_;
+
+  // Scene listed by the Hierarchy and edited through the Inspector
+  std::shared_ptr<Scene> hierarchy_scene_;
+  // Sphere indices passing the filter, in order, and the query they match
+  std::vector<std::uint32_t> hierarchy_rows_;
+  std::string hierarchy_rows_query_;
+  ImGuiTextFilter hierarchy_filter_;
+  // Identifies the newest filter job; older ones give up or are ignored
+  std::atomic<std::uint64_t> hierarchy_filter_generation_;
+  std::atomic<std::shared_ptr<HierarchyFilterResult>> hierarchy_filter_result_;
+  bool hierarchy_filter_pending_;
+  // Holds sphere indices rather than row positions, so it survives
+  // refiltering
+  ImGuiSelectionBasicStorage hierarchy_selection_;
+  std::vector<SphereEdit> pending_sphere_edits_;
+
+  // Whether edits only re-render the tiles they cover, and how far those
+  // tiles reach around an edited sphere, in multiples of its radius
+  bool dirty_regions_enabled_;
+  float dirty_region_widening_;
 };
 
 #endif  // APPLICATION_H
@@ -0,0 +1,90 @@
+#include "AsyncLogWriter.h"
+
+// STL
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <stop_token>
+#include <string>
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// src
+#include "LogRing.h"
+
+namespace {
+
+// How long entries may wait in the ring before being written
+constexpr std::chrono::milliseconds kDrainInterval{ 20 };
+
+}  // namespace
+
+AsyncLogWriter::AsyncLogWriter(
+    LogRing& ring,
+    const std::filesystem::path& file_path)
+    : ring_{ ring }
+    , file_{ nullptr } {
+  if (!file_path.empty()) {
+    file_ = std::fopen(file_path.string().c_str(), "a");
+    if (!file_) {
+      spdlog::error("Failed to open log file {}.", file_path.string());
+    }
+  }
+
+  thread_ = std::jthread{ [this](std::stop_token stop_token) {
+    RunWriter(stop_token);
+  } };
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+  // Stop the writer, then flush whatever was logged since its last drain
+  thread_.request_stop();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  Drain();
+
+  if (file_) {
+    std::fclose(file_);
+  }
+}
+
+void AsyncLogWriter::RunWriter(std::stop_token stop_token) {
+  while (!stop_token.stop_requested()) {
+    Drain();
+
+    // Sleep until the next drain, waking early if asked to stop
+    std::unique_lock lock{ mutex_ };
+    stop_requested_.wait_for(lock, stop_token, kDrainInterval, []() { return false; });
+  }
+}
+
+void AsyncLogWriter::Drain() {
+  LogEntry entry{};
+  bool wrote_anything{ false };
+  while (ring_.TryPop(entry)) {
+    const std::string line{ FormatLogEntry(entry) };
+    std::fprintf(stderr, "%s\n", line.c_str());
+    if (file_) {
+      std::fprintf(file_, "%s\n", line.c_str());
+    }
+    wrote_anything = true;
+  }
+
+  // Report entries lost to a full ring
+  const std::size_t dropped_count{ ring_.TakeDroppedCount() };
+  if (dropped_count > 0U) {
+    std::fprintf(stderr, "Dropped %zu log messages.\n", dropped_count);
+    if (file_) {
+      std::fprintf(file_, "Dropped %zu log messages.\n", dropped_count);
+    }
+    wrote_anything = true;
+  }
+
+  if (wrote_anything && file_) {
+    std::fflush(file_);
+  }
+}
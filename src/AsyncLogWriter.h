@@ -0,0 +1,42 @@
+#ifndef ASYNCLOGWRITER_H
+#define ASYNCLOGWRITER_H
+
+// STL
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+// Forward declarations
+class LogRing;
+
+// Drains a log ring on a background thread, echoing entries to stderr
+// and appending them to a file, so threads that log never wait on I/O.
+// Used in place of the editor's Console for headless runs; entries still
+// in the ring are written out when the writer is destroyed.
+class AsyncLogWriter {
+public:
+  // Writes to stderr only if file_path is empty or cannot be opened
+  AsyncLogWriter(LogRing& ring, const std::filesystem::path& file_path);
+  ~AsyncLogWriter();
+
+  AsyncLogWriter(const AsyncLogWriter&) = delete;
+  AsyncLogWriter& operator=(const AsyncLogWriter&) = delete;
+
+private:
+  void RunWriter(std::stop_token stop_token);
+
+  // Writes every entry currently in the ring
+  void Drain();
+
+private:
+  LogRing& ring_;
+  std::FILE* file_;
+  std::mutex mutex_;
+  std::condition_variable_any stop_requested_;
+  std::jthread thread_;
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include "EnvironmentMap.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// glm
+#include "glm/vec3.hpp"
+#include "glm/geometric.hpp"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// src
+#include "AliasTable.h"
+#include "Sampling.h"
+
+namespace {
+
+glm::vec3 DecodeRgbe(const std::uint8_t* rgbe) {
+  if (rgbe[3] == 0U) {
+    return glm::vec3{ 0.0F, 0.0F, 0.0F };
+  }
+
+  const float scale{ std::ldexp(1.0F, static_cast<int>(rgbe[3]) - (128 + 8)) };
+  return glm::vec3{
+    (static_cast<float>(rgbe[0]) + 0.5F) * scale,
+    (static_cast<float>(rgbe[1]) + 0.5F) * scale,
+    (static_cast<float>(rgbe[2]) + 0.5F) * scale
+  };
+}
+
+// Reads one scanline in either flat or new-style run-length encoding
+bool ReadScanline(std::ifstream& input_file,
+                  std::uint32_t width,
+                  std::vector<std::uint8_t>& scanline) {
+  scanline.resize(4U * static_cast<std::size_t>(width));
+
+  std::uint8_t marker[4]{};
+  input_file.read(reinterpret_cast<char*>(marker), 4);
+  if (!input_file) {
+    return false;
+  }
+
+  const bool is_rle{
+    width >= 8U && width < 32768U
+    && marker[0] == 2U && marker[1] == 2U && (marker[2] & 0x80U) == 0U
+  };
+  if (!is_rle) {
+    std::copy_n(marker, 4U, scanline.begin());
+    input_file.read(reinterpret_cast<char*>(scanline.data() + 4),
+                    static_cast<std::streamsize>(scanline.size() - 4U));
+    return static_cast<bool>(input_file);
+  }
+
+  if ((static_cast<std::uint32_t>(marker[2]) << 8U | marker[3]) != width) {
+    return false;
+  }
+
+  // Each channel is stored as its own run-length encoded plane
+  for (std::size_t channel{ 0U }; channel < 4U; ++channel) {
+    std::size_t x{ 0U };
+    while (x < width) {
+      const int count_byte{ input_file.get() };
+      if (count_byte == std::char_traits<char>::eof()) {
+        return false;
+      }
+
+      if (count_byte > 128) {
+        const std::size_t count{ static_cast<std::size_t>(count_byte - 128) };
+        const int value{ input_file.get() };
+        if (x + count > width || value == std::char_traits<char>::eof()) {
+          return false;
+        }
+        for (std::size_t i{ 0U }; i < count; ++i, ++x) {
+          scanline[4U * x + channel] = static_cast<std::uint8_t>(value);
+        }
+      } else {
+        const std::size_t count{ static_cast<std::size_t>(count_byte) };
+        if (count == 0U || x + count > width) {
+          return false;
+        }
+        for (std::size_t i{ 0U }; i < count; ++i, ++x) {
+          scanline[4U * x + channel] = static_cast<std::uint8_t>(input_file.get());
+        }
+      }
+    }
+  }
+
+  return static_cast<bool>(input_file);
+}
+
+}  // namespace
+
+EnvironmentMap::EnvironmentMap(
+    std::uint32_t width,
+    std::uint32_t height,
+    std::vector<glm::vec3> radiance)
+    : width_{ width }
+    , height_{ height }
+    , radiance_{ std::move(radiance) } {
+  // Weight texels by luminance and by the solid angle they subtend,
+  // which shrinks towards the poles of the equirectangular projection
+  std::vector<float> weights(radiance_.size());
+  for (std::uint32_t y{ 0U }; y < height_; ++y) {
+    const float theta{
+      kPi * (static_cast<float>(y) + 0.5F) / static_cast<float>(height_)
+    };
+    const float sin_theta{ std::sin(theta) };
+    for (std::uint32_t x{ 0U }; x < width_; ++x) {
+      const std::size_t texel{ static_cast<std::size_t>(y) * width_ + x };
+      weights[texel] = Luminance(radiance_[texel]) * sin_theta;
+    }
+  }
+
+  alias_table_ = AliasTable{ weights };
+}
+
+std::shared_ptr<EnvironmentMap> EnvironmentMap::Load(
+    const std::filesystem::path& path) {
+  std::ifstream input_file{ path, std::ios::binary };
+  if (!input_file) {
+    spdlog::error("Failed to open environment map {}.", path.string());
+    return nullptr;
+  }
+
+  // Read header lines up to the blank line preceding the resolution
+  std::string line{};
+  std::getline(input_file, line);
+  if (line.rfind("#?", 0U) != 0U) {
+    spdlog::error("Environment map {} is not a Radiance HDR image.", path.string());
+    return nullptr;
+  }
+  while (std::getline(input_file, line) && !line.empty()) {
+    if (line.rfind("FORMAT=", 0U) == 0U && line != "FORMAT=32-bit_rle_rgbe") {
+      spdlog::error("Environment map {} has unsupported {}.", path.string(), line);
+      return nullptr;
+    }
+  }
+
+  // Only the standard top-to-bottom, left-to-right orientation is supported
+  std::string y_axis{};
+  std::string x_axis{};
+  std::uint32_t width{};
+  std::uint32_t height{};
+  input_file >> y_axis >> height >> x_axis >> width;
+  input_file.get();
+  if (!input_file || y_axis != "-Y" || x_axis != "+X" || width == 0U || height == 0U) {
+    spdlog::error("Environment map {} has an unsupported resolution line.",
+                  path.string());
+    return nullptr;
+  }
+
+  // Decode scanlines
+  std::vector<glm::vec3> radiance(static_cast<std::size_t>(width) * height);
+  std::vector<std::uint8_t> scanline{};
+  for (std::uint32_t y{ 0U }; y < height; ++y) {
+    if (!ReadScanline(input_file, width, scanline)) {
+      spdlog::error("Environment map {} is corrupt.", path.string());
+      return nullptr;
+    }
+    for (std::uint32_t x{ 0U }; x < width; ++x) {
+      radiance[static_cast<std::size_t>(y) * width + x] =
+        DecodeRgbe(scanline.data() + 4U * x);
+    }
+  }
+
+  spdlog::info("Loaded {}x{} environment map {}.", width, height, path.string());
+  return std::make_shared<EnvironmentMap>(width, height, std::move(radiance));
+}
+
+glm::vec3 EnvironmentMap::Evaluate(const glm::vec3& direction) const noexcept {
+  return radiance_[DirectionToTexel(direction)];
+}
+
+EnvironmentSample EnvironmentMap::Sample(
+    float u0,
+    float u1,
+    float u2) const noexcept {
+  // Pick a texel proportional to its weight, then a uniform point in it
+  const std::size_t texel{ alias_table_.Sample(u0) };
+  const std::size_t texel_x{ texel % width_ };
+  const std::size_t texel_y{ texel / width_ };
+  const float u{ (static_cast<float>(texel_x) + u1) / static_cast<float>(width_) };
+  const float v{ (static_cast<float>(texel_y) + u2) / static_cast<float>(height_) };
+
+  // Map to a direction; v runs from +Y (top row) to -Y
+  const float phi{ 2.0F * kPi * u - kPi };
+  const float theta{ kPi * v };
+  const float sin_theta{ std::sin(theta) };
+
+  EnvironmentSample sample{};
+  sample.direction = glm::vec3{
+    sin_theta * std::sin(phi),
+    std::cos(theta),
+    -sin_theta * std::cos(phi)
+  };
+  sample.radiance = radiance_[texel];
+  sample.pdf = TexelPdf(texel, sin_theta);
+
+  return sample;
+}
+
+float EnvironmentMap::Pdf(const glm::vec3& direction) const noexcept {
+  const float sin_theta{
+    std::sqrt(std::max(0.0F, 1.0F - direction.y * direction.y))
+  };
+  return TexelPdf(DirectionToTexel(direction), sin_theta);
+}
+
+std::size_t EnvironmentMap::DirectionToTexel(
+    const glm::vec3& direction) const noexcept {
+  const float u{ (std::atan2(direction.x, -direction.z) + kPi) / (2.0F * kPi) };
+  const float v{ std::acos(std::clamp(direction.y, -1.0F, 1.0F)) / kPi };
+
+  const std::size_t x{
+    std::min(static_cast<std::size_t>(u * static_cast<float>(width_)),
+             static_cast<std::size_t>(width_ - 1U))
+  };
+  const std::size_t y{
+    std::min(static_cast<std::size_t>(v * static_cast<float>(height_)),
+             static_cast<std::size_t>(height_ - 1U))
+  };
+
+  return y * width_ + x;
+}
+
+float EnvironmentMap::TexelPdf(
+    std::size_t texel,
+    float sin_theta) const noexcept {
+  if (sin_theta <= 0.0F) {
+    return 0.0F;
+  }
+
+  // Convert from density over the unit square of texture coordinates
+  // to density over solid angle
+  const float texel_count{ static_cast<float>(radiance_.size()) };
+  return alias_table_.Probability(texel) * texel_count
+         / (2.0F * kPi * kPi * sin_theta);
+}
@@ -0,0 +1,68 @@
+#ifndef ENVIRONMENTMAP_H
+#define ENVIRONMENTMAP_H
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+// glm
+#include "glm/vec3.hpp"
+
+// src
+#include "AliasTable.h"
+
+struct EnvironmentSample {
+  glm::vec3 direction;
+  glm::vec3 radiance;
+  float pdf;
+};
+
+// Equirectangular HDR environment, importance sampled by luminance.
+//
+// Texels are treated as piecewise constant both when evaluating and when
+// sampling, so Pdf() exactly matches the density Sample() draws from and
+// the two can be combined with BSDF sampling by multiple importance
+// sampling.
+class EnvironmentMap {
+public:
+  EnvironmentMap() = delete;
+  EnvironmentMap(
+    std::uint32_t width,
+    std::uint32_t height,
+    std::vector<glm::vec3> radiance);
+
+  // Loads a Radiance RGBE (.hdr) image
+  [[nodiscard]]
+  static std::shared_ptr<EnvironmentMap> Load(
+    const std::filesystem::path& path);
+
+  // Radiance arriving from direction
+  [[nodiscard]]
+  glm::vec3 Evaluate(const glm::vec3& direction) const noexcept;
+
+  // Draws a direction proportional to luminance in O(1)
+  [[nodiscard]]
+  EnvironmentSample Sample(float u0, float u1, float u2) const noexcept;
+
+  // Solid angle density with which Sample() returns direction
+  [[nodiscard]]
+  float Pdf(const glm::vec3& direction) const noexcept;
+
+private:
+  [[nodiscard]]
+  std::size_t DirectionToTexel(const glm::vec3& direction) const noexcept;
+
+  [[nodiscard]]
+  float TexelPdf(std::size_t texel, float sin_theta) const noexcept;
+
+private:
+  std::uint32_t width_;
+  std::uint32_t height_;
+  std::vector<glm::vec3> radiance_;
+  AliasTable alias_table_;
+};
+
+#endif
@@ -2,19 +2,43 @@
 #define IRAYTRACEABLE_H
 
 // STL
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <optional>
 
 // glm
+#include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 
 // Forward declarations
 class Ray;
 
+// Index of a texture opened in the scene's TextureCache
+using TextureId = std::uint32_t;
+inline constexpr TextureId kNoTexture{ std::numeric_limits<TextureId>::max() };
+
+struct Material {
+  glm::vec3 albedo{ 0.5F, 0.5F, 0.5F };
+  glm::vec3 emission{ 0.0F, 0.0F, 0.0F };
+  // Multiplies the albedo if set
+  TextureId albedo_texture{ kNoTexture };
+};
+
+// Marks trace results not produced by a packed scene primitive
+inline constexpr std::size_t kNoPrimitive{ std::numeric_limits<std::size_t>::max() };
+
 struct TraceResult {
   glm::vec3 impact_position;
   glm::vec3 impact_normal;
   float distance;
   bool is_front_face;
+  Material material;
+  std::size_t primitive_index{ kNoPrimitive };
+  // Where the material's texture is looked up, and the texture-space
+  // distance per world-space unit there; only set for textured materials
+  glm::vec2 texture_coordinates{ 0.0F, 0.0F };
+  float texture_scale{ 0.0F };
 };
 
 class IRayTraceable {
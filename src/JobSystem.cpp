@@ -0,0 +1,106 @@
+#include "JobSystem.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+JobSystem::JobSystem(std::size_t thread_count) {
+  thread_count = std::max<std::size_t>(thread_count, 1U);
+  threads_.reserve(thread_count);
+  for (std::size_t i{ 0U }; i < thread_count; ++i) {
+    threads_.emplace_back([this](std::stop_token stop_token) {
+      RunWorker(stop_token);
+    });
+  }
+}
+
+JobSystem::~JobSystem() {
+  // Ask workers to stop and wake them; they finish the queued jobs first,
+  // so no group is left waiting on a dropped job
+  for (std::jthread& thread : threads_) {
+    thread.request_stop();
+  }
+  jobs_available_.notify_all();
+  threads_.clear();
+}
+
+void JobSystem::Submit(std::function<void()> job) {
+  {
+    const std::scoped_lock lock{ mutex_ };
+    jobs_.emplace_back(Job{ nullptr, std::move(job) });
+  }
+  jobs_available_.notify_one();
+}
+
+void JobSystem::Submit(JobGroup& group, std::function<void()> job) {
+  group.pending.fetch_add(1U, std::memory_order_relaxed);
+  {
+    const std::scoped_lock lock{ mutex_ };
+    ++group.queued;
+    jobs_.emplace_back(Job{ &group, [this, &group, job = std::move(job)]() {
+      job();
+      // Decrement under the lock so a waiter cannot miss the wakeup; the
+      // group may be gone once pending drops to zero
+      {
+        const std::scoped_lock finish_lock{ mutex_ };
+        group.pending.fetch_sub(1U, std::memory_order_release);
+      }
+      group_progress_.notify_all();
+    } });
+  }
+  jobs_available_.notify_one();
+  group_progress_.notify_all();
+}
+
+void JobSystem::Wait(JobGroup& group) {
+  // Help out with the group's own jobs rather than idling, and sleep
+  // while the remaining ones run on other threads. Running unrelated
+  // jobs here could nest a job that blocks on something only this
+  // thread's outer frame will provide.
+  std::unique_lock lock{ mutex_ };
+  while (group.pending.load(std::memory_order_acquire) > 0U) {
+    if (group.queued == 0U) {
+      group_progress_.wait(lock);
+      continue;
+    }
+
+    const auto queued_job{
+      std::ranges::find(jobs_, &group, [](const Job& job) -> const JobGroup* {
+        return job.group;
+      })
+    };
+    std::function<void()> job{ std::move(queued_job->function) };
+    jobs_.erase(queued_job);
+    --group.queued;
+
+    lock.unlock();
+    job();
+    lock.lock();
+  }
+}
+
+void JobSystem::RunWorker(std::stop_token stop_token) {
+  // Keep going after a stop request until the queue is empty
+  while (true) {
+    std::function<void()> job{};
+    {
+      std::unique_lock lock{ mutex_ };
+      if (!jobs_available_.wait(lock, stop_token, [this]() { return !jobs_.empty(); })) {
+        return;
+      }
+      if (JobGroup* const group{ jobs_.front().group }) {
+        --group->queued;
+      }
+      job = std::move(jobs_.front().function);
+      jobs_.pop_front();
+    }
+
+    job();
+  }
+}
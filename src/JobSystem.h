@@ -0,0 +1,71 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+// STL
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+// Tracks a set of jobs so a caller can wait for all of them at once
+struct JobGroup {
+  std::atomic<std::size_t> pending{ 0U };
+  // Jobs of the group still in the queue; guarded by the JobSystem's lock
+  std::size_t queued{ 0U };
+};
+
+// Fixed-size pool of worker threads executing jobs in FIFO order.
+//
+// Waiting on a group runs that group's queued jobs on the waiting thread,
+// and only sleeps while the rest are running elsewhere, so jobs may
+// themselves submit and wait for nested jobs (e.g. recursive acceleration
+// structure builds) without deadlocking. Jobs must not otherwise block, e.g. on a future or a lock
+// held while waiting, as that can starve the pool. Jobs still queued on
+// destruction are run before the workers stop.
+class JobSystem {
+public:
+  explicit JobSystem(std::size_t thread_count = std::thread::hardware_concurrency());
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  // Queues a job not tracked by any group
+  void Submit(std::function<void()> job);
+
+  // Queues a job that group waits on
+  void Submit(JobGroup& group, std::function<void()> job);
+
+  // Returns once every job of group has finished, running only jobs of
+  // group meanwhile
+  void Wait(JobGroup& group);
+
+  [[nodiscard]]
+  std::size_t thread_count() const noexcept {
+    return threads_.size();
+  }
+
+private:
+  struct Job {
+    // Group the job belongs to; null if untracked
+    JobGroup* group;
+    std::function<void()> function;
+  };
+
+  void RunWorker(std::stop_token stop_token);
+
+private:
+  std::mutex mutex_;
+  std::condition_variable_any jobs_available_;
+  // Signalled whenever a grouped job is queued or finishes
+  std::condition_variable group_progress_;
+  std::deque<Job> jobs_;
+  std::vector<std::jthread> threads_;
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include "Kernels.h"
+
+// STL
+#include <atomic>
+#include <cstdlib>
+#include <optional>
+#include <string_view>
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// Kernel variants, each defined in its own translation unit
+extern const KernelTable kGenericKernels;
+#if defined(RTIOW_KERNELS_X86)
+extern const KernelTable kSse42Kernels;
+extern const KernelTable kAvx2Kernels;
+extern const KernelTable kAvx512Kernels;
+#endif
+
+#if defined(RTIOW_KERNELS_X86) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace {
+
+std::atomic<const KernelTable*> selected_kernels{ &kGenericKernels };
+
+#if defined(RTIOW_KERNELS_X86) && defined(_MSC_VER) && !defined(__clang__)
+bool HasCpuidBit(int leaf, int subleaf, int reg, int bit) {
+  int registers[4]{};
+  __cpuidex(registers, leaf, subleaf);
+  return (registers[reg] & (1 << bit)) != 0;
+}
+
+bool OsSavesAvxState() {
+  // OSXSAVE must be set and XCR0 must enable SSE and AVX state
+  return HasCpuidBit(1, 0, 2, 27) && (_xgetbv(0) & 0x6) == 0x6;
+}
+
+bool OsSavesAvx512State() {
+  // XCR0 must additionally enable opmask and ZMM state
+  return OsSavesAvxState() && (_xgetbv(0) & 0xE6) == 0xE6;
+}
+#endif
+
+bool IsSupported(KernelIsa isa) noexcept {
+  switch (isa) {
+    case KernelIsa::kGeneric: { return true; }
+#if defined(RTIOW_KERNELS_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+    case KernelIsa::kSse42: {
+      return HasCpuidBit(1, 0, 2, 20);
+    }
+    case KernelIsa::kAvx2: {
+      return OsSavesAvxState()
+             && HasCpuidBit(7, 0, 1, 5)     // AVX2
+             && HasCpuidBit(1, 0, 2, 12);   // FMA
+    }
+    case KernelIsa::kAvx512: {
+      return OsSavesAvx512State()
+             && HasCpuidBit(7, 0, 1, 16)    // AVX512F
+             && HasCpuidBit(7, 0, 1, 30)    // AVX512BW
+             && HasCpuidBit(7, 0, 1, 31);   // AVX512VL
+    }
+#else
+    // The builtins query cpuid and account for OS support of the
+    // extended register state
+    case KernelIsa::kSse42: {
+      return __builtin_cpu_supports("sse4.2");
+    }
+    case KernelIsa::kAvx2: {
+      return __builtin_cpu_supports("avx2")
+             && __builtin_cpu_supports("fma");
+    }
+    case KernelIsa::kAvx512: {
+      return __builtin_cpu_supports("avx512f")
+             && __builtin_cpu_supports("avx512bw")
+             && __builtin_cpu_supports("avx512vl");
+    }
+#endif
+#endif
+    default: { return false; }
+  }
+}
+
+const KernelTable& GetKernelTable(KernelIsa isa) noexcept {
+  switch (isa) {
+#if defined(RTIOW_KERNELS_X86)
+    case KernelIsa::kSse42: { return kSse42Kernels; }
+    case KernelIsa::kAvx2: { return kAvx2Kernels; }
+    case KernelIsa::kAvx512: { return kAvx512Kernels; }
+#endif
+    default: { return kGenericKernels; }
+  }
+}
+
+}  // namespace
+
+KernelIsa DetectKernelIsa() noexcept {
+  // Walk variants from most to least capable
+  for (const KernelIsa isa : { KernelIsa::kAvx512,
+                               KernelIsa::kAvx2,
+                               KernelIsa::kSse42 }) {
+    if (IsSupported(isa)) {
+      return isa;
+    }
+  }
+
+  return KernelIsa::kGeneric;
+}
+
+bool InitializeKernels(std::optional<std::string_view> isa_override) {
+  // Fall back to the environment if no override was passed explicitly
+  if (!isa_override.has_value()) {
+    if (const char* isa_environment{ std::getenv("RTIOW_ISA") }) {
+      isa_override = isa_environment;
+    }
+  }
+
+  KernelIsa isa{ DetectKernelIsa() };
+  if (isa_override.has_value()) {
+    const std::optional<KernelIsa> requested_isa{
+      ParseKernelIsa(isa_override.value())
+    };
+    if (!requested_isa.has_value()) {
+      spdlog::error("Unknown kernel ISA \"{}\".", isa_override.value());
+      return false;
+    }
+    if (!IsSupported(requested_isa.value())) {
+      spdlog::error("Kernel ISA {} is not supported by this CPU.",
+                    ToString(requested_isa.value()));
+      return false;
+    }
+    isa = requested_isa.value();
+  }
+
+  selected_kernels.store(&GetKernelTable(isa), std::memory_order_release);
+  spdlog::info("Using {} kernels.", ToString(isa));
+
+  return true;
+}
+
+const KernelTable& GetKernels() noexcept {
+  return *selected_kernels.load(std::memory_order_acquire);
+}
+
+std::optional<KernelIsa> ParseKernelIsa(std::string_view name) noexcept {
+  if (name == "generic") { return KernelIsa::kGeneric; }
+  if (name == "sse4.2") { return KernelIsa::kSse42; }
+  if (name == "avx2") { return KernelIsa::kAvx2; }
+  if (name == "avx512") { return KernelIsa::kAvx512; }
+  return std::nullopt;
+}
+
+std::string_view ToString(KernelIsa isa) noexcept {
+  switch (isa) {
+    case KernelIsa::kGeneric: { return "generic"; }
+    case KernelIsa::kSse42: { return "sse4.2"; }
+    case KernelIsa::kAvx2: { return "avx2"; }
+    case KernelIsa::kAvx512: { return "avx512"; }
+    default: { return "unknown"; }
+  }
+}
@@ -0,0 +1,96 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+
+// Instruction set variants the hot kernels are compiled for,
+// ordered from least to most capable
+enum class KernelIsa {
+  kGeneric,
+  kSse42,
+  kAvx2,
+  kAvx512
+};
+
+// Structure-of-arrays view over packed sphere data
+struct SphereArrays {
+  const float* center_x;
+  const float* center_y;
+  const float* center_z;
+  const float* radius;
+  std::size_t count;
+};
+
+// Camera parameters needed to generate primary rays
+struct PrimaryRayParams {
+  float origin[3];
+  float upper_left_pixel[3];
+  float delta_u[3];
+  float delta_v[3];
+};
+
+// Returned by the sphere intersection kernel when no sphere was hit
+inline constexpr std::size_t kNoHit{ std::numeric_limits<std::size_t>::max() };
+
+// Finds the nearest sphere whose intersection distance lies within
+// (min_distance, max_distance); returns its index or kNoHit
+using IntersectSpheresFn = std::size_t (*)(
+  const SphereArrays& spheres,
+  const float* origin,
+  const float* direction,
+  float min_distance,
+  float max_distance,
+  float* out_distance);
+
+// Writes normalized primary ray directions for count consecutive pixels
+// of a single row, each jittered by the given subpixel offsets
+using GeneratePrimaryRaysFn = void (*)(
+  const PrimaryRayParams& params,
+  std::size_t row,
+  std::size_t first_column,
+  std::size_t count,
+  const float* jitter_u,
+  const float* jitter_v,
+  float* direction_x,
+  float* direction_y,
+  float* direction_z);
+
+// Scales, clamps and quantizes linear values to 8-bit
+using TonemapFn = void (*)(
+  const float* values,
+  std::size_t count,
+  float scale,
+  std::uint8_t* output);
+
+struct KernelTable {
+  KernelIsa isa;
+  IntersectSpheresFn intersect_spheres;
+  GeneratePrimaryRaysFn generate_primary_rays;
+  TonemapFn tonemap;
+};
+
+// Returns the most capable kernel variant supported by the host CPU
+[[nodiscard]]
+KernelIsa DetectKernelIsa() noexcept;
+
+// Selects the kernel variant to use; isa_override (or the RTIOW_ISA
+// environment variable if not provided) forces a specific variant,
+// which must still be supported by the host CPU
+bool InitializeKernels(std::optional<std::string_view> isa_override);
+
+// Returns the currently selected kernel variant
+[[nodiscard]]
+const KernelTable& GetKernels() noexcept;
+
+[[nodiscard]]
+std::optional<KernelIsa> ParseKernelIsa(std::string_view name) noexcept;
+
+[[nodiscard]]
+std::string_view ToString(KernelIsa isa) noexcept;
+
+#endif
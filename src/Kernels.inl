@@ -0,0 +1,172 @@
+// Shared implementation of the hot kernels. This file is included by one
+// translation unit per instruction set, each compiled with its own ISA
+// flags and defining RTIOW_KERNEL_ISA and RTIOW_KERNEL_TABLE beforehand.
+//
+// Everything here has internal linkage and avoids inline functions from
+// other headers (glm, <algorithm>, <cmath>), so the linker can never fold
+// an AVX-compiled copy of a shared inline function into code that runs
+// on a CPU without AVX.
+
+#if !defined(RTIOW_KERNEL_ISA) || !defined(RTIOW_KERNEL_TABLE)
+#error "RTIOW_KERNEL_ISA and RTIOW_KERNEL_TABLE must be defined"
+#endif
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <immintrin.h>
+#endif
+
+// src
+#include "Kernels.h"
+
+namespace {
+
+constexpr std::size_t kBlockSize{ 64U };
+constexpr float kInfinity{ std::numeric_limits<float>::infinity() };
+
+float SquareRoot(float value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(value)));
+#else
+  return __builtin_sqrtf(value);
+#endif
+}
+
+std::size_t IntersectSpheres(
+    const SphereArrays& spheres,
+    const float* origin,
+    const float* direction,
+    float min_distance,
+    float max_distance,
+    float* out_distance) {
+  std::size_t nearest_index{ kNoHit };
+  float nearest_distance{ max_distance };
+
+  // Process spheres in fixed-size blocks; the root computation of a block
+  // is branch-free so the compiler can vectorize it at the target width
+  alignas(64) float roots[kBlockSize];
+  for (std::size_t block_begin{ 0U };
+       block_begin < spheres.count;
+       block_begin += kBlockSize) {
+    const std::size_t remaining{ spheres.count - block_begin };
+    const std::size_t block_count{
+      remaining < kBlockSize ? remaining : kBlockSize
+    };
+    const float limit{ nearest_distance };
+
+    const float* center_x{ spheres.center_x + block_begin };
+    const float* center_y{ spheres.center_y + block_begin };
+    const float* center_z{ spheres.center_z + block_begin };
+    const float* radius{ spheres.radius + block_begin };
+
+    for (std::size_t i{ 0U }; i < block_count; ++i) {
+      // Compute quadratic terms needed to determine the discriminant
+      const float to_center_x{ center_x[i] - origin[0] };
+      const float to_center_y{ center_y[i] - origin[1] };
+      const float to_center_z{ center_z[i] - origin[2] };
+      const float h{
+        to_center_x * direction[0]
+        + to_center_y * direction[1]
+        + to_center_z * direction[2]
+      };
+      const float c{
+        to_center_x * to_center_x
+        + to_center_y * to_center_y
+        + to_center_z * to_center_z
+        - radius[i] * radius[i]
+      };
+      const float discriminant{ h * h - c };
+      const float sqrt_d{ SquareRoot(discriminant < 0.0F ? 0.0F : discriminant) };
+
+      // Prefer the negative root, fall back to the positive one
+      const float near_root{ h - sqrt_d };
+      const float far_root{ h + sqrt_d };
+      const bool near_in_range{
+        min_distance < near_root && near_root < limit
+      };
+      const float root{ near_in_range ? near_root : far_root };
+      const bool in_range{
+        discriminant >= 0.0F && min_distance < root && root < limit
+      };
+      roots[i] = in_range ? root : kInfinity;
+    }
+
+    // Reduce the block to its nearest hit
+    for (std::size_t i{ 0U }; i < block_count; ++i) {
+      if (roots[i] < nearest_distance) {
+        nearest_distance = roots[i];
+        nearest_index = block_begin + i;
+      }
+    }
+  }
+
+  if (nearest_index != kNoHit) {
+    *out_distance = nearest_distance;
+  }
+  return nearest_index;
+}
+
+void GeneratePrimaryRays(
+    const PrimaryRayParams& params,
+    std::size_t row,
+    std::size_t first_column,
+    std::size_t count,
+    const float* jitter_u,
+    const float* jitter_v,
+    float* direction_x,
+    float* direction_y,
+    float* direction_z) {
+  // Hoist the row-invariant part of the sample position
+  const float v{ static_cast<float>(row) };
+  float row_origin[3];
+  for (std::size_t axis{ 0U }; axis < 3U; ++axis) {
+    row_origin[axis] = params.upper_left_pixel[axis] - params.origin[axis];
+  }
+
+  for (std::size_t i{ 0U }; i < count; ++i) {
+    const float u{ static_cast<float>(first_column + i) + jitter_u[i] };
+    const float sample_v{ v + jitter_v[i] };
+
+    const float x{
+      row_origin[0] + u * params.delta_u[0] + sample_v * params.delta_v[0]
+    };
+    const float y{
+      row_origin[1] + u * params.delta_u[1] + sample_v * params.delta_v[1]
+    };
+    const float z{
+      row_origin[2] + u * params.delta_u[2] + sample_v * params.delta_v[2]
+    };
+
+    const float inverse_length{ 1.0F / SquareRoot(x * x + y * y + z * z) };
+    direction_x[i] = x * inverse_length;
+    direction_y[i] = y * inverse_length;
+    direction_z[i] = z * inverse_length;
+  }
+}
+
+void Tonemap(
+    const float* values,
+    std::size_t count,
+    float scale,
+    std::uint8_t* output) {
+  for (std::size_t i{ 0U }; i < count; ++i) {
+    float value{ values[i] * scale };
+    value = value < 0.0F ? 0.0F : value;
+    value = value > 0.999F ? 0.999F : value;
+    output[i] = static_cast<std::uint8_t>(255.999F * value);
+  }
+}
+
+}  // namespace
+
+extern const KernelTable RTIOW_KERNEL_TABLE;
+const KernelTable RTIOW_KERNEL_TABLE{
+  RTIOW_KERNEL_ISA,
+  &IntersectSpheres,
+  &GeneratePrimaryRays,
+  &Tonemap
+};
@@ -0,0 +1,4 @@
+// Kernel variant compiled with AVX2 and FMA; see CMakeLists.txt
+#define RTIOW_KERNEL_ISA KernelIsa::kAvx2
+#define RTIOW_KERNEL_TABLE kAvx2Kernels
+#include "Kernels.inl"
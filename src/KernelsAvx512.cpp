@@ -0,0 +1,4 @@
+// Kernel variant compiled with AVX-512 (F, VL, BW); see CMakeLists.txt
+#define RTIOW_KERNEL_ISA KernelIsa::kAvx512
+#define RTIOW_KERNEL_TABLE kAvx512Kernels
+#include "Kernels.inl"
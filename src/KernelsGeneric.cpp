@@ -0,0 +1,4 @@
+// Kernel variant compiled with baseline compiler flags; see CMakeLists.txt
+#define RTIOW_KERNEL_ISA KernelIsa::kGeneric
+#define RTIOW_KERNEL_TABLE kGenericKernels
+#include "Kernels.inl"
@@ -0,0 +1,4 @@
+// Kernel variant compiled with SSE4.2; see CMakeLists.txt
+#define RTIOW_KERNEL_ISA KernelIsa::kSse42
+#define RTIOW_KERNEL_TABLE kSse42Kernels
+#include "Kernels.inl"
@@ -0,0 +1,259 @@
+#include "LightTree.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// glm
+#include "glm/vec3.hpp"
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+
+// src
+#include "Sampling.h"
+
+LightTree::LightTree(std::vector<SphereLight> lights)
+    : lights_{ std::move(lights) } {
+  if (lights_.empty()) {
+    return;
+  }
+
+  // A balanced binary tree over N lights has 2N - 1 nodes
+  nodes_.reserve(2U * lights_.size() - 1U);
+  light_paths_.resize(lights_.size());
+  BuildNode(0U, lights_.size(), 0U, 0U);
+
+  light_of_primitive_.reserve(lights_.size());
+  for (std::size_t i{ 0U }; i < lights_.size(); ++i) {
+    light_of_primitive_.emplace(lights_[i].primitive_index,
+                                static_cast<std::uint32_t>(i));
+  }
+}
+
+std::optional<LightSample> LightTree::Sample(
+    const glm::vec3& position,
+    const glm::vec3& normal,
+    float u0,
+    float u1,
+    float u2) const {
+  if (nodes_.empty()) {
+    return std::nullopt;
+  }
+
+  // Descend towards the light, reusing u0 at every level by rescaling
+  // it into the chosen child's share of the unit interval
+  float selection_pmf{ 1.0F };
+  std::uint32_t node_index{ 0U };
+  while (nodes_[node_index].right_child != 0U) {
+    const std::uint32_t left_child{ node_index + 1U };
+    const std::uint32_t right_child{ nodes_[node_index].right_child };
+    const float left_importance{
+      ComputeImportance(nodes_[left_child], position, normal)
+    };
+    const float right_importance{
+      ComputeImportance(nodes_[right_child], position, normal)
+    };
+    const float total_importance{ left_importance + right_importance };
+    if (total_importance <= 0.0F) {
+      return std::nullopt;
+    }
+
+    const float left_probability{ left_importance / total_importance };
+    if (u0 < left_probability) {
+      u0 /= left_probability;
+      selection_pmf *= left_probability;
+      node_index = left_child;
+    } else {
+      u0 = (u0 - left_probability) / (1.0F - left_probability);
+      selection_pmf *= 1.0F - left_probability;
+      node_index = right_child;
+    }
+    u0 = std::min(u0, 0.99999994F);
+  }
+
+  // Sample the cone of directions subtended by the chosen sphere
+  const SphereLight& light{ lights_[nodes_[node_index].light_index] };
+  const glm::vec3 to_center{ light.center - position };
+  const float distance_squared{ glm::dot(to_center, to_center) };
+  const float radius_squared{ light.radius * light.radius };
+  if (distance_squared <= radius_squared) {
+    return std::nullopt;
+  }
+
+  const float sin_theta_max_squared{ radius_squared / distance_squared };
+  const float cos_theta_max{ std::sqrt(1.0F - sin_theta_max_squared) };
+  // 1 - cos(theta_max), computed without cancellation for distant lights
+  const float one_minus_cos_theta_max{
+    sin_theta_max_squared / (1.0F + cos_theta_max)
+  };
+
+  const float one_minus_cos_theta{ u1 * one_minus_cos_theta_max };
+  const float cos_theta{ 1.0F - one_minus_cos_theta };
+  const float sin_theta{
+    std::sqrt(std::max(0.0F, one_minus_cos_theta * (2.0F - one_minus_cos_theta)))
+  };
+  const float phi{ 2.0F * kPi * u2 };
+
+  const float distance_to_center{ std::sqrt(distance_squared) };
+  const glm::vec3 axis{ to_center / distance_to_center };
+  glm::vec3 tangent{};
+  glm::vec3 bitangent{};
+  BuildOrthonormalBasis(axis, tangent, bitangent);
+
+  LightSample sample{};
+  sample.direction = sin_theta * std::cos(phi) * tangent
+                     + sin_theta * std::sin(phi) * bitangent
+                     + cos_theta * axis;
+  sample.radiance = light.emission;
+  sample.pdf = selection_pmf / (2.0F * kPi * one_minus_cos_theta_max);
+
+  // Distance to the near side of the sphere along the sampled direction
+  const float h{ glm::dot(to_center, sample.direction) };
+  const float discriminant{
+    std::max(0.0F, h * h - (distance_squared - radius_squared))
+  };
+  sample.distance = h - std::sqrt(discriminant);
+
+  return sample;
+}
+
+float LightTree::Pdf(
+    const glm::vec3& position,
+    const glm::vec3& normal,
+    std::size_t primitive_index) const {
+  const auto light_entry{ light_of_primitive_.find(primitive_index) };
+  if (light_entry == light_of_primitive_.end()) {
+    return 0.0F;
+  }
+  const std::uint32_t light_index{ light_entry->second };
+  const LightPath& path{ light_paths_[light_index] };
+
+  // Replay the branch decisions Sample() would have taken to reach the light
+  float selection_pmf{ 1.0F };
+  std::uint32_t node_index{ 0U };
+  for (std::uint32_t level{ 0U }; level < path.depth; ++level) {
+    const std::uint32_t left_child{ node_index + 1U };
+    const std::uint32_t right_child{ nodes_[node_index].right_child };
+    const float left_importance{
+      ComputeImportance(nodes_[left_child], position, normal)
+    };
+    const float right_importance{
+      ComputeImportance(nodes_[right_child], position, normal)
+    };
+    const float total_importance{ left_importance + right_importance };
+    if (total_importance <= 0.0F) {
+      return 0.0F;
+    }
+
+    const bool go_right{ ((path.bits >> level) & 1U) != 0U };
+    selection_pmf *= (go_right ? right_importance : left_importance) / total_importance;
+    node_index = go_right ? right_child : left_child;
+  }
+
+  return selection_pmf * ComputeConePdf(lights_[light_index], position);
+}
+
+std::uint32_t LightTree::BuildNode(
+    std::size_t begin,
+    std::size_t end,
+    std::uint64_t path_bits,
+    std::uint32_t depth) {
+  const std::uint32_t node_index{ static_cast<std::uint32_t>(nodes_.size()) };
+  nodes_.emplace_back();
+
+  // Compute bounds and total power of the lights below this node
+  Node node{};
+  node.bounds_min = lights_[begin].center - glm::vec3{ lights_[begin].radius };
+  node.bounds_max = lights_[begin].center + glm::vec3{ lights_[begin].radius };
+  glm::vec3 centroid_min{ lights_[begin].center };
+  glm::vec3 centroid_max{ lights_[begin].center };
+  for (std::size_t i{ begin }; i < end; ++i) {
+    const SphereLight& light{ lights_[i] };
+    node.bounds_min = glm::min(node.bounds_min, light.center - glm::vec3{ light.radius });
+    node.bounds_max = glm::max(node.bounds_max, light.center + glm::vec3{ light.radius });
+    centroid_min = glm::min(centroid_min, light.center);
+    centroid_max = glm::max(centroid_max, light.center);
+
+    // Emitted flux is proportional to radiance times surface area
+    node.power += Luminance(light.emission) * light.radius * light.radius;
+  }
+
+  // Leaves hold a single light so every light has its own selection path
+  if (end - begin == 1U) {
+    node.light_index = static_cast<std::uint32_t>(begin);
+    nodes_[node_index] = node;
+    light_paths_[begin] = LightPath{ path_bits, depth };
+    return node_index;
+  }
+
+  // Split at the median along the widest axis of the light centers
+  const glm::vec3 centroid_extent{ centroid_max - centroid_min };
+  std::size_t axis{ 0U };
+  if (centroid_extent.y > centroid_extent[axis]) { axis = 1U; }
+  if (centroid_extent.z > centroid_extent[axis]) { axis = 2U; }
+
+  const std::size_t middle{ begin + (end - begin) / 2U };
+  std::nth_element(
+    lights_.begin() + static_cast<std::ptrdiff_t>(begin),
+    lights_.begin() + static_cast<std::ptrdiff_t>(middle),
+    lights_.begin() + static_cast<std::ptrdiff_t>(end),
+    [axis](const SphereLight& a, const SphereLight& b) {
+      return a.center[axis] < b.center[axis];
+    }
+  );
+
+  BuildNode(begin, middle, path_bits, depth + 1U);
+  node.right_child = BuildNode(middle, end, path_bits | (1ULL << depth), depth + 1U);
+  nodes_[node_index] = node;
+
+  return node_index;
+}
+
+float LightTree::ComputeImportance(
+    const Node& node,
+    const glm::vec3& position,
+    const glm::vec3& normal) noexcept {
+  const glm::vec3 center{ 0.5F * (node.bounds_min + node.bounds_max) };
+  const glm::vec3 extent{ node.bounds_max - node.bounds_min };
+  const glm::vec3 to_center{ center - position };
+
+  // Clusters entirely below the tangent plane cannot light the point
+  const glm::vec3 absolute_normal{ glm::abs(normal) };
+  const float max_height{
+    glm::dot(to_center, normal) + 0.5F * glm::dot(extent, absolute_normal)
+  };
+  if (max_height <= 0.0F) {
+    return 0.0F;
+  }
+
+  // Inverse square falloff, clamped inside the cluster so nearby
+  // clusters do not get unbounded weight
+  const float distance_squared{ glm::dot(to_center, to_center) };
+  const float min_distance_squared{ 0.25F * glm::dot(extent, extent) };
+
+  return node.power / std::max(distance_squared, min_distance_squared);
+}
+
+float LightTree::ComputeConePdf(
+    const SphereLight& light,
+    const glm::vec3& position) noexcept {
+  const glm::vec3 to_center{ light.center - position };
+  const float distance_squared{ glm::dot(to_center, to_center) };
+  const float radius_squared{ light.radius * light.radius };
+  if (distance_squared <= radius_squared) {
+    return 0.0F;
+  }
+
+  const float sin_theta_max_squared{ radius_squared / distance_squared };
+  const float cos_theta_max{ std::sqrt(1.0F - sin_theta_max_squared) };
+  const float one_minus_cos_theta_max{
+    sin_theta_max_squared / (1.0F + cos_theta_max)
+  };
+
+  return 1.0F / (2.0F * kPi * one_minus_cos_theta_max);
+}
@@ -0,0 +1,108 @@
+#ifndef LIGHTTREE_H
+#define LIGHTTREE_H
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// glm
+#include "glm/vec3.hpp"
+
+struct SphereLight {
+  glm::vec3 center;
+  float radius;
+  glm::vec3 emission;
+  std::size_t primitive_index;
+};
+
+struct LightSample {
+  glm::vec3 direction;
+  glm::vec3 radiance;
+  float distance;
+  float pdf;
+};
+
+// Bounding volume hierarchy over emissive spheres for many-light sampling.
+//
+// Each node stores the bounds and total emitted power of the lights below
+// it. Sampling walks from the root, choosing a child in proportion to a
+// conservative estimate of its contribution at the shading point, so a
+// light is picked in O(log N) and roughly in proportion to how much it
+// can actually illuminate that point.
+class LightTree {
+public:
+  LightTree() = default;
+  explicit LightTree(std::vector<SphereLight> lights);
+
+  // Picks a light and a direction towards it as seen from position
+  [[nodiscard]]
+  std::optional<LightSample> Sample(
+    const glm::vec3& position,
+    const glm::vec3& normal,
+    float u0,
+    float u1,
+    float u2) const;
+
+  // Solid angle density with which Sample() returns a direction hitting
+  // the light built from primitive_index; zero if it is not a light
+  [[nodiscard]]
+  float Pdf(
+    const glm::vec3& position,
+    const glm::vec3& normal,
+    std::size_t primitive_index) const;
+
+  [[nodiscard]]
+  bool empty() const noexcept {
+    return lights_.empty();
+  }
+
+  [[nodiscard]]
+  std::size_t size() const noexcept {
+    return lights_.size();
+  }
+
+private:
+  // Nodes are laid out depth first, so a left child directly follows its
+  // parent; leaves have no right child and reference exactly one light
+  struct Node {
+    glm::vec3 bounds_min;
+    float power;
+    glm::vec3 bounds_max;
+    std::uint32_t right_child;
+    std::uint32_t light_index;
+  };
+
+  // Root-to-leaf branch decisions of a light, one bit per level
+  struct LightPath {
+    std::uint64_t bits;
+    std::uint32_t depth;
+  };
+
+  std::uint32_t BuildNode(
+    std::size_t begin,
+    std::size_t end,
+    std::uint64_t path_bits,
+    std::uint32_t depth);
+
+  [[nodiscard]]
+  static float ComputeImportance(
+    const Node& node,
+    const glm::vec3& position,
+    const glm::vec3& normal) noexcept;
+
+  [[nodiscard]]
+  static float ComputeConePdf(
+    const SphereLight& light,
+    const glm::vec3& position) noexcept;
+
+private:
+  std::vector<Node> nodes_;
+  std::vector<SphereLight> lights_;
+  std::vector<LightPath> light_paths_;
+  std::unordered_map<std::size_t, std::uint32_t> light_of_primitive_;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "LogRing.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// spdlog
+#include "spdlog/spdlog.h"
+#include "spdlog/fmt/chrono.h"
+
+namespace {
+
+// Enough for bursts of warnings from every worker between two drains
+constexpr std::size_t kLogRingCapacity{ 8192U };
+
+}  // namespace
+
+LogRing::LogRing(std::size_t capacity)
+    : slots_{ nullptr }
+    , mask_{ std::bit_ceil(std::max<std::size_t>(capacity, 2U)) - 1U }
+    , push_position_{ 0U }
+    , pop_position_{ 0U }
+    , dropped_count_{ 0U } {
+  // Each slot starts out free for the push at its own position
+  slots_ = std::make_unique<Slot[]>(mask_ + 1U);
+  for (std::size_t i{ 0U }; i <= mask_; ++i) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+bool LogRing::TryPush(
+    std::chrono::system_clock::time_point time,
+    spdlog::level::level_enum level,
+    std::string_view message) noexcept {
+  // Claim the slot at the current push position, unless the consumer
+  // has not freed it yet
+  std::size_t position{ push_position_.load(std::memory_order_relaxed) };
+  Slot* slot{ nullptr };
+  while (true) {
+    slot = &slots_[position & mask_];
+    const std::size_t sequence{ slot->sequence.load(std::memory_order_acquire) };
+    const std::ptrdiff_t difference{
+      static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position)
+    };
+    if (difference == 0) {
+      if (push_position_.compare_exchange_weak(position, position + 1U,
+                                               std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (difference < 0) {
+      dropped_count_.fetch_add(1U, std::memory_order_relaxed);
+      return false;
+    } else {
+      position = push_position_.load(std::memory_order_relaxed);
+    }
+  }
+
+  // Fill the slot, then publish it to the consumer
+  LogEntry& entry{ slot->entry };
+  entry.time = time;
+  entry.level = level;
+  entry.length = static_cast<std::uint32_t>(std::min(message.size(), kMaxLogMessageSize));
+  std::copy_n(message.data(), entry.length, entry.text);
+  slot->sequence.store(position + 1U, std::memory_order_release);
+
+  return true;
+}
+
+bool LogRing::TryPop(LogEntry& entry) noexcept {
+  Slot& slot{ slots_[pop_position_ & mask_] };
+  if (slot.sequence.load(std::memory_order_acquire) != pop_position_ + 1U) {
+    return false;
+  }
+
+  // Copy the entry out, then free the slot for the push one lap ahead
+  entry = slot.entry;
+  slot.sequence.store(pop_position_ + mask_ + 1U, std::memory_order_release);
+  ++pop_position_;
+
+  return true;
+}
+
+std::size_t LogRing::TakeDroppedCount() noexcept {
+  return dropped_count_.exchange(0U, std::memory_order_relaxed);
+}
+
+LogRingSink::LogRingSink(LogRing& ring) noexcept
+    : ring_{ ring } {}
+
+void LogRingSink::log(const spdlog::details::log_msg& message) {
+  ring_.TryPush(message.time, message.level,
+                std::string_view{ message.payload.data(), message.payload.size() });
+}
+
+LogRing& GetLogRing() {
+  static LogRing ring{ kLogRingCapacity };
+  return ring;
+}
+
+void InitializeLogging() {
+  std::shared_ptr<spdlog::logger> logger{
+    std::make_shared<spdlog::logger>("rtiow", std::make_shared<LogRingSink>(GetLogRing()))
+  };
+  spdlog::set_default_logger(std::move(logger));
+}
+
+std::string FormatLogEntry(const LogEntry& entry) {
+  const spdlog::string_view_t level_name{ spdlog::level::to_string_view(entry.level) };
+  return fmt::format("[{:%Y-%m-%d %H:%M:%S}] [{}] {}",
+                     std::chrono::floor<std::chrono::milliseconds>(entry.time),
+                     std::string_view{ level_name.data(), level_name.size() },
+                     entry.message());
+}
@@ -0,0 +1,103 @@
+#ifndef LOGRING_H
+#define LOGRING_H
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// spdlog
+#include "spdlog/common.h"
+#include "spdlog/sinks/sink.h"
+
+// Longer messages are truncated so entries can live in fixed slots
+inline constexpr std::size_t kMaxLogMessageSize{ 240U };
+
+struct LogEntry {
+  std::chrono::system_clock::time_point time;
+  spdlog::level::level_enum level;
+  std::uint32_t length;
+  char text[kMaxLogMessageSize];
+
+  [[nodiscard]]
+  std::string_view message() const noexcept {
+    return std::string_view{ text, length };
+  }
+};
+
+// Bounded multi-producer, single-consumer queue of log entries.
+//
+// Producers claim a slot with a single compare-and-swap and publish it
+// through the slot's sequence number, so logging threads never take a
+// lock, allocate or touch I/O. When the ring is full, entries are dropped
+// and counted rather than making producers wait for the consumer.
+class LogRing {
+public:
+  // capacity is rounded up to a power of two
+  explicit LogRing(std::size_t capacity);
+
+  LogRing(const LogRing&) = delete;
+  LogRing& operator=(const LogRing&) = delete;
+
+  // Copies the message into the ring; returns false if it was dropped
+  bool TryPush(
+    std::chrono::system_clock::time_point time,
+    spdlog::level::level_enum level,
+    std::string_view message) noexcept;
+
+  // Takes the oldest published entry; must only be called by one thread
+  // at a time
+  bool TryPop(LogEntry& entry) noexcept;
+
+  // Number of entries dropped since the last call
+  [[nodiscard]]
+  std::size_t TakeDroppedCount() noexcept;
+
+private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    LogEntry entry;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  std::size_t mask_;
+
+  // Kept on separate cache lines so producers and the consumer do not
+  // invalidate each other's position
+  alignas(64) std::atomic<std::size_t> push_position_;
+  alignas(64) std::size_t pop_position_;
+  alignas(64) std::atomic<std::size_t> dropped_count_;
+};
+
+// spdlog sink pushing raw messages into a ring without formatting them,
+// as spdlog's formatters are not safe to share between threads unlocked
+class LogRingSink final : public spdlog::sinks::sink {
+public:
+  explicit LogRingSink(LogRing& ring) noexcept;
+
+  void log(const spdlog::details::log_msg& message) override;
+  void flush() override {}
+  void set_pattern(const std::string&) override {}
+  void set_formatter(std::unique_ptr<spdlog::formatter>) override {}
+
+private:
+  LogRing& ring_;
+};
+
+// Ring every logger writes into once logging is initialized
+[[nodiscard]]
+LogRing& GetLogRing();
+
+// Replaces spdlog's default logger with one writing into GetLogRing();
+// the ring must then be drained by the editor or an AsyncLogWriter
+void InitializeLogging();
+
+// Formats an entry as a single line, without a trailing newline
+[[nodiscard]]
+std::string FormatLogEntry(const LogEntry& entry);
+
+#endif
@@ -0,0 +1,639 @@
+#include "PagedGeometry.h"
+
+// STL
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// glm
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+#include "glm/vec3.hpp"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// src
+#include "IRayTraceable.h"
+#include "Kernels.h"
+#include "PositionalFile.h"
+#include "Ray.h"
+#include "SpaceFillingCurve.h"
+#include "Sphere.h"
+#include "SphereBvh.h"
+#include "WideBvh.h"
+
+namespace {
+
+struct PagedGeometryHeader {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint64_t sphere_count;
+  std::uint32_t material_count;
+  std::uint32_t node_count;
+  std::uint32_t cluster_count;
+  std::uint32_t cluster_size;
+  std::uint64_t index_offset;
+};
+
+// Bytes one cluster of the given size takes in the file
+std::uint64_t ComputeClusterFileBytes(std::uint64_t node_count, std::uint64_t sphere_count) {
+  return node_count * sizeof(WideBvhNode)
+         + sphere_count * (4U * sizeof(float) + sizeof(std::uint32_t));
+}
+
+// Checks that every child of a wide hierarchy is in range before a
+// traversal follows it. Interior children must come after their parent,
+// as CollapseBvh allocates them, so a corrupt file cannot send a
+// traversal around in a loop.
+bool ValidateWideBvh(const std::vector<WideBvhNode>& nodes, std::size_t item_count) {
+  for (std::size_t i{ 0U }; i < nodes.size(); ++i) {
+    const WideBvhNode& node{ nodes[i] };
+    if (node.child_count == 0U || node.child_count > WideBvhNode::kWidth) {
+      return false;
+    }
+    for (std::size_t j{ 0U }; j < node.child_count; ++j) {
+      const std::uint32_t child{ node.child[j] };
+      if ((child & WideBvhNode::kLeafFlag) != 0U) {
+        const std::size_t first_item{ child & WideBvhNode::kIndexMask };
+        const std::size_t leaf_count{
+          ((child >> WideBvhNode::kLeafCountShift) & WideBvhNode::kLeafCountMask) + 1U
+        };
+        if (first_item + leaf_count > item_count) {
+          return false;
+        }
+      } else if (child <= i || child >= nodes.size()) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// Reads count values at offset, then advances offset past them; callers
+// check count against the file size first
+template <typename T>
+bool ReadArray(
+    const PositionalFile& file,
+    std::uint64_t& offset,
+    std::vector<T>& values,
+    std::size_t count) {
+  values.resize(count);
+  if (!file.Read(offset, values.data(), count * sizeof(T))) {
+    return false;
+  }
+  offset += count * sizeof(T);
+  return true;
+}
+
+template <typename T>
+void WriteArray(std::ofstream& output_file, const std::vector<T>& values) {
+  output_file.write(reinterpret_cast<const char*>(values.data()),
+                    static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template <typename T>
+void ApplyOrder(std::vector<T>& values, const std::vector<std::uint32_t>& order) {
+  std::vector<T> ordered_values{};
+  ordered_values.reserve(values.size());
+  for (const std::uint32_t index : order) {
+    ordered_values.emplace_back(values[index]);
+  }
+  values = std::move(ordered_values);
+}
+
+// Distance at which a ray enters a box, or infinity if it misses it
+// within the distance range
+float ComputeEntryDistance(
+    const float* bounds_min,
+    const float* bounds_max,
+    const float* origin,
+    const float* inverse_direction,
+    float min_distance,
+    float max_distance) {
+  float entry{ min_distance };
+  float exit{ max_distance };
+  for (std::size_t axis{ 0U }; axis < 3U; ++axis) {
+    const float near_plane{ (bounds_min[axis] - origin[axis]) * inverse_direction[axis] };
+    const float far_plane{ (bounds_max[axis] - origin[axis]) * inverse_direction[axis] };
+    entry = std::max(entry, std::min(near_plane, far_plane));
+    exit = std::min(exit, std::max(near_plane, far_plane));
+  }
+
+  return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+}
+
+}  // namespace
+
+std::size_t PagedGeometry::Cluster::bytes() const noexcept {
+  return nodes.size() * sizeof(WideBvhNode)
+         + radius.size() * (4U * sizeof(float) + sizeof(std::uint32_t));
+}
+
+PagedGeometry::PagedGeometry(
+    std::unique_ptr<const PositionalFile> file,
+    std::size_t capacity_bytes)
+    : file_{ std::move(file) }
+    , sphere_count_{ 0U }
+    , shard_capacity_bytes_{ capacity_bytes / kShardCount }
+    , page_hits_{ 0U }
+    , page_faults_{ 0U }
+    , evictions_{ 0U } {}
+
+std::shared_ptr<PagedGeometry> PagedGeometry::Open(
+    const std::filesystem::path& path,
+    std::size_t capacity_bytes) {
+  std::unique_ptr<const PositionalFile> file{ PositionalFile::Open(path) };
+  if (!file) {
+    spdlog::error("Failed to open geometry {}.", path.string());
+    return nullptr;
+  }
+  const PositionalFile& geometry_file{ *file };
+  std::shared_ptr<PagedGeometry> geometry{
+    new PagedGeometry{ std::move(file), capacity_bytes }
+  };
+
+  // Validate header
+  PagedGeometryHeader header{};
+  if (!geometry_file.Read(0U, &header, sizeof(header))
+      || header.magic != kMagic
+      || header.version != kVersion
+      || header.node_count == 0U
+      || header.cluster_count == 0U
+      || header.node_count > header.cluster_count
+      || header.cluster_size == 0U
+      || header.cluster_size > kClusterSize) {
+    spdlog::error("Geometry {} is not a valid geometry file.", path.string());
+    return nullptr;
+  }
+
+  // Check the index fits in the file before allocating room for it; the
+  // counts are 32-bit, so none of these sizes overflow
+  const std::optional<std::uint64_t> file_size{ geometry_file.Size() };
+  const std::uint64_t index_bytes{
+    std::uint64_t{ header.material_count } * 6U * sizeof(float)
+    + header.node_count * sizeof(WideBvhNode)
+    + header.cluster_count * sizeof(ClusterInfo)
+  };
+  if (!file_size.has_value()
+      || header.index_offset > file_size.value()
+      || index_bytes > file_size.value() - header.index_offset) {
+    spdlog::error("Geometry {} is truncated.", path.string());
+    return nullptr;
+  }
+
+  // Read the index, which stays resident
+  std::vector<float> palette{};
+  std::uint64_t offset{ header.index_offset };
+  if (!ReadArray(geometry_file, offset, palette,
+                 6U * static_cast<std::size_t>(header.material_count))
+      || !ReadArray(geometry_file, offset, geometry->nodes_, header.node_count)
+      || !ReadArray(geometry_file, offset, geometry->clusters_, header.cluster_count)) {
+    spdlog::error("Geometry {} is truncated.", path.string());
+    return nullptr;
+  }
+
+  // Check every cluster lies within the file and agrees with the header,
+  // and that the top-level hierarchy only references existing clusters
+  std::uint64_t cluster_sphere_count{ 0U };
+  for (const ClusterInfo& cluster : geometry->clusters_) {
+    if (cluster.sphere_count == 0U || cluster.sphere_count > header.cluster_size
+        || cluster.node_count == 0U || cluster.node_count > cluster.sphere_count
+        || cluster.offset > file_size.value()
+        || ComputeClusterFileBytes(cluster.node_count, cluster.sphere_count)
+             > file_size.value() - cluster.offset) {
+      spdlog::error("Geometry {} has an invalid cluster table.", path.string());
+      return nullptr;
+    }
+    cluster_sphere_count += cluster.sphere_count;
+  }
+  if (cluster_sphere_count != header.sphere_count
+      || !ValidateWideBvh(geometry->nodes_, geometry->clusters_.size())) {
+    spdlog::error("Geometry {} has an invalid index.", path.string());
+    return nullptr;
+  }
+  geometry->sphere_count_ = header.sphere_count;
+  for (std::size_t i{ 0U }; i < header.material_count; ++i) {
+    geometry->materials_.emplace_back(Material{
+      glm::vec3{ palette[6U * i + 0U], palette[6U * i + 1U], palette[6U * i + 2U] },
+      glm::vec3{ palette[6U * i + 3U], palette[6U * i + 4U], palette[6U * i + 5U] }
+    });
+  }
+
+  // Warn if a single cluster would not fit in a shard, as every lookup
+  // would then miss
+  std::uint64_t max_cluster_bytes{ 0U };
+  for (const ClusterInfo& cluster : geometry->clusters_) {
+    max_cluster_bytes = std::max(
+      max_cluster_bytes, ComputeClusterFileBytes(cluster.node_count, cluster.sphere_count)
+    );
+  }
+  if (max_cluster_bytes > geometry->shard_capacity_bytes_) {
+    spdlog::warn("Geometry cache shard capacity is smaller than one cluster of {}.",
+                 path.string());
+  }
+
+  spdlog::info("Opened geometry {} with {} spheres in {} clusters ({} KiB index).",
+               path.string(), geometry->sphere_count_, geometry->clusters_.size(),
+               (geometry->nodes_.size() * sizeof(WideBvhNode)
+                + geometry->clusters_.size() * sizeof(ClusterInfo)) / 1024U);
+  return geometry;
+}
+
+bool PagedGeometry::Write(
+    const std::filesystem::path& path,
+    const SphereArrays& spheres,
+    const std::vector<Material>& materials) {
+  if (spheres.count == 0U || materials.size() != spheres.count
+      || spheres.count > std::numeric_limits<std::uint32_t>::max()) {
+    spdlog::error("Geometry must have between 1 and 2^32 - 1 spheres, each with a material.");
+    return false;
+  }
+
+  std::ofstream output_file{ path, std::ios::binary };
+  if (!output_file) {
+    spdlog::error("Failed to open geometry {} for writing.", path.string());
+    return false;
+  }
+
+  // Reserve room for the header, which is written once the index offset
+  // is known
+  PagedGeometryHeader header{};
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.sphere_count = spheres.count;
+  header.cluster_size = kClusterSize;
+  output_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  // Store each distinct material once
+  std::map<std::array<float, 6>, std::uint32_t> palette_indices{};
+  std::vector<float> palette{};
+  std::vector<std::uint32_t> material_indices(spheres.count);
+  for (std::size_t i{ 0U }; i < spheres.count; ++i) {
+    const Material& material{ materials[i] };
+    const std::array<float, 6> key{
+      material.albedo.r, material.albedo.g, material.albedo.b,
+      material.emission.r, material.emission.g, material.emission.b
+    };
+    const auto [entry, inserted] = palette_indices.try_emplace(
+      key, static_cast<std::uint32_t>(palette_indices.size())
+    );
+    if (inserted) {
+      palette.insert(palette.end(), key.begin(), key.end());
+    }
+    material_indices[i] = entry->second;
+  }
+
+  // Sort spheres along a Morton curve through the bounds of their centers
+  // so consecutive runs form compact clusters
+  glm::vec3 bounds_min{ std::numeric_limits<float>::infinity() };
+  glm::vec3 bounds_max{ -std::numeric_limits<float>::infinity() };
+  for (std::size_t i{ 0U }; i < spheres.count; ++i) {
+    const glm::vec3 center{ spheres.center_x[i], spheres.center_y[i], spheres.center_z[i] };
+    bounds_min = glm::min(bounds_min, center);
+    bounds_max = glm::max(bounds_max, center);
+  }
+  const glm::vec3 cell_scale{
+    1023.0F / glm::max(bounds_max - bounds_min, glm::vec3{ 1.0e-6F })
+  };
+  std::vector<std::uint64_t> keys(spheres.count);
+  for (std::size_t i{ 0U }; i < spheres.count; ++i) {
+    const glm::vec3 cell{
+      (glm::vec3{ spheres.center_x[i], spheres.center_y[i], spheres.center_z[i] } - bounds_min)
+      * cell_scale
+    };
+    const std::uint64_t code{
+      MortonEncode3D(static_cast<std::uint32_t>(cell.x),
+                     static_cast<std::uint32_t>(cell.y),
+                     static_cast<std::uint32_t>(cell.z))
+    };
+    keys[i] = (code << 32U) | i;
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // Write clusters of consecutive spheres, each reordered into the leaf
+  // order of its own hierarchy
+  std::vector<ClusterInfo> clusters{};
+  std::vector<float> center_x{};
+  std::vector<float> center_y{};
+  std::vector<float> center_z{};
+  std::vector<float> radius{};
+  std::vector<std::uint32_t> cluster_materials{};
+  std::vector<std::uint32_t> order{};
+  SphereBvh bvh{};
+  for (std::size_t first{ 0U }; first < spheres.count; first += kClusterSize) {
+    const std::size_t count{ std::min<std::size_t>(kClusterSize, spheres.count - first) };
+    center_x.clear();
+    center_y.clear();
+    center_z.clear();
+    radius.clear();
+    cluster_materials.clear();
+    for (std::size_t i{ first }; i < first + count; ++i) {
+      const std::uint32_t sphere{ static_cast<std::uint32_t>(keys[i]) };
+      center_x.emplace_back(spheres.center_x[sphere]);
+      center_y.emplace_back(spheres.center_y[sphere]);
+      center_z.emplace_back(spheres.center_z[sphere]);
+      radius.emplace_back(spheres.radius[sphere]);
+      cluster_materials.emplace_back(material_indices[sphere]);
+    }
+
+    bvh.Build(SphereArrays{ center_x.data(), center_y.data(), center_z.data(),
+                            radius.data(), count },
+              nullptr, nullptr, order);
+    ApplyOrder(center_x, order);
+    ApplyOrder(center_y, order);
+    ApplyOrder(center_z, order);
+    ApplyOrder(radius, order);
+    ApplyOrder(cluster_materials, order);
+    const std::vector<WideBvhNode> nodes{ CollapseBvh(bvh.nodes()) };
+
+    const BvhNode& root{ bvh.nodes()[0] };
+    clusters.emplace_back(ClusterInfo{
+      { root.bounds_min.x, root.bounds_min.y, root.bounds_min.z },
+      static_cast<std::uint32_t>(nodes.size()),
+      { root.bounds_max.x, root.bounds_max.y, root.bounds_max.z },
+      static_cast<std::uint32_t>(count),
+      static_cast<std::uint64_t>(output_file.tellp())
+    });
+    WriteArray(output_file, nodes);
+    WriteArray(output_file, center_x);
+    WriteArray(output_file, center_y);
+    WriteArray(output_file, center_z);
+    WriteArray(output_file, radius);
+    WriteArray(output_file, cluster_materials);
+  }
+
+  // Build the resident hierarchy over spheres enclosing the clusters'
+  // bounds, which are conservative for the boxes
+  center_x.clear();
+  center_y.clear();
+  center_z.clear();
+  radius.clear();
+  for (const ClusterInfo& cluster : clusters) {
+    const glm::vec3 cluster_min{
+      cluster.bounds_min[0], cluster.bounds_min[1], cluster.bounds_min[2]
+    };
+    const glm::vec3 cluster_max{
+      cluster.bounds_max[0], cluster.bounds_max[1], cluster.bounds_max[2]
+    };
+    const glm::vec3 center{ 0.5F * (cluster_min + cluster_max) };
+    center_x.emplace_back(center.x);
+    center_y.emplace_back(center.y);
+    center_z.emplace_back(center.z);
+    radius.emplace_back(0.5F * glm::length(cluster_max - cluster_min));
+  }
+  bvh.Build(SphereArrays{ center_x.data(), center_y.data(), center_z.data(),
+                          radius.data(), clusters.size() },
+            nullptr, nullptr, order);
+  ApplyOrder(clusters, order);
+  const std::vector<WideBvhNode> nodes{ CollapseBvh(bvh.nodes()) };
+
+  // Write the index, then fill in the header
+  header.material_count = static_cast<std::uint32_t>(palette_indices.size());
+  header.node_count = static_cast<std::uint32_t>(nodes.size());
+  header.cluster_count = static_cast<std::uint32_t>(clusters.size());
+  header.index_offset = static_cast<std::uint64_t>(output_file.tellp());
+  WriteArray(output_file, palette);
+  WriteArray(output_file, nodes);
+  WriteArray(output_file, clusters);
+  output_file.seekp(0);
+  output_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  if (!output_file) {
+    spdlog::error("Failed to write geometry {}.", path.string());
+    return false;
+  }
+
+  spdlog::info("Wrote {} spheres in {} clusters with {} materials to {}.",
+               spheres.count, clusters.size(), palette_indices.size(), path.string());
+  return true;
+}
+
+std::optional<TraceResult> PagedGeometry::TraceRay(
+    const Ray& ray,
+    float min_distance,
+    float max_distance) const {
+  const KernelTable& kernels{ GetKernels() };
+  const float origin[3]{ ray.origin().x, ray.origin().y, ray.origin().z };
+  const float direction[3]{ ray.direction().x, ray.direction().y, ray.direction().z };
+  const float inverse_direction[3]{
+    1.0F / direction[0], 1.0F / direction[1], 1.0F / direction[2]
+  };
+
+  // The nearest sphere is copied out, as its cluster may be evicted once
+  // the traversal moves on
+  float nearest_distance{ max_distance };
+  bool hit_anything{ false };
+  glm::vec3 nearest_center{};
+  float nearest_radius{};
+  std::uint32_t nearest_material{ 0U };
+
+  TraverseWideBvh(
+    nodes_.data(), origin, inverse_direction, min_distance, nearest_distance,
+    [&](std::uint32_t first_cluster, std::uint32_t cluster_count) {
+      // Only page in clusters whose exact bounds the ray reaches, nearest
+      // first so hits cull the clusters behind them
+      std::pair<float, std::uint32_t> entries[WideBvhNode::kLeafCountMask + 1U];
+      std::size_t entry_count{ 0U };
+      for (std::uint32_t index{ first_cluster }; index < first_cluster + cluster_count; ++index) {
+        const ClusterInfo& info{ clusters_[index] };
+        const float entry_distance{
+          ComputeEntryDistance(info.bounds_min, info.bounds_max, origin, inverse_direction,
+                               min_distance, nearest_distance)
+        };
+        if (entry_distance < nearest_distance) {
+          entries[entry_count++] = std::pair{ entry_distance, index };
+        }
+      }
+      std::sort(entries, entries + entry_count);
+
+      for (std::size_t i{ 0U }; i < entry_count; ++i) {
+        const auto [entry_distance, index] = entries[i];
+        if (entry_distance >= nearest_distance) {
+          break;
+        }
+        const std::shared_ptr<const Cluster> cluster{ GetCluster(index) };
+        if (!cluster) {
+          continue;
+        }
+
+        TraverseWideBvh(
+          cluster->nodes.data(), origin, inverse_direction, min_distance, nearest_distance,
+          [&](std::uint32_t first_sphere, std::uint32_t sphere_count) {
+            const SphereArrays leaf_spheres{
+              cluster->center_x.data() + first_sphere,
+              cluster->center_y.data() + first_sphere,
+              cluster->center_z.data() + first_sphere,
+              cluster->radius.data() + first_sphere,
+              sphere_count
+            };
+            float distance{};
+            const std::size_t leaf_index{
+              kernels.intersect_spheres(leaf_spheres, origin, direction,
+                                        min_distance, nearest_distance, &distance)
+            };
+            if (leaf_index != kNoHit) {
+              const std::size_t sphere{ first_sphere + leaf_index };
+              hit_anything = true;
+              nearest_distance = distance;
+              nearest_center = glm::vec3{
+                cluster->center_x[sphere], cluster->center_y[sphere], cluster->center_z[sphere]
+              };
+              nearest_radius = cluster->radius[sphere];
+              nearest_material = cluster->material[sphere];
+            }
+          });
+      }
+    });
+
+  if (!hit_anything) {
+    return std::nullopt;
+  }
+
+  return Sphere::ResolveTraceResult(ray, nearest_center, nearest_radius,
+                                    materials_[nearest_material], nearest_distance);
+}
+
+PagedGeometryStats PagedGeometry::GetStats() const noexcept {
+  PagedGeometryStats stats{};
+  stats.page_hits = page_hits_.load(std::memory_order_relaxed);
+  stats.page_faults = page_faults_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  stats.capacity_bytes = shard_capacity_bytes_ * kShardCount;
+  for (Shard& shard : shards_) {
+    const std::scoped_lock lock{ shard.mutex };
+    stats.resident_clusters += shard.entries.size();
+    stats.resident_bytes += shard.resident_bytes;
+  }
+
+  return stats;
+}
+
+void PagedGeometry::LogStats() const {
+  const PagedGeometryStats stats{ GetStats() };
+  const std::uint64_t lookups{ stats.page_hits + stats.page_faults };
+  const double hit_rate{
+    lookups > 0U
+      ? 100.0 * static_cast<double>(stats.page_hits) / static_cast<double>(lookups)
+      : 0.0
+  };
+  spdlog::info("Geometry cache: {} page hits, {} page faults ({:.2f}% hit rate), "
+               "{} evictions, {}/{} clusters in {}/{} MiB resident.",
+               stats.page_hits, stats.page_faults, hit_rate, stats.evictions,
+               stats.resident_clusters, clusters_.size(),
+               stats.resident_bytes / (1024U * 1024U),
+               stats.capacity_bytes / (1024U * 1024U));
+}
+
+std::shared_ptr<const PagedGeometry::Cluster> PagedGeometry::GetCluster(
+    std::uint32_t cluster) const {
+  Shard& shard{ shards_[cluster % kShardCount] };
+
+  // Fast path: cluster is resident, mark it most recently used.
+  // Otherwise, publish the pending read so other threads missing the same
+  // cluster wait for it instead of reading it again.
+  std::promise<std::shared_ptr<const Cluster>> promise{};
+  ClusterFuture cluster_future{};
+  bool needs_read{ false };
+  {
+    const std::scoped_lock lock{ shard.mutex };
+    if (const auto entry{ shard.entries.find(cluster) }; entry != shard.entries.end()) {
+      shard.lru.splice(shard.lru.begin(), shard.lru, entry->second);
+      page_hits_.fetch_add(1U, std::memory_order_relaxed);
+      return entry->second->second;
+    }
+    if (shard.failed.contains(cluster)) {
+      return nullptr;
+    }
+    if (const auto load{ shard.loading.find(cluster) }; load != shard.loading.end()) {
+      cluster_future = load->second;
+    } else {
+      cluster_future = promise.get_future().share();
+      shard.loading.emplace(cluster, cluster_future);
+      needs_read = true;
+    }
+  }
+  page_faults_.fetch_add(1U, std::memory_order_relaxed);
+
+  // The reading thread only waits on the disk, so waiting on it is safe
+  // even from a pool job
+  if (!needs_read) {
+    return cluster_future.get();
+  }
+
+  // Read the cluster without holding the shard lock so other threads can
+  // keep hitting the shard while this one waits on the disk
+  const std::shared_ptr<const Cluster> loaded_cluster{ ReadCluster(cluster) };
+  if (!loaded_cluster) {
+    spdlog::error("Failed to read geometry cluster {}.", cluster);
+  }
+
+  const std::scoped_lock lock{ shard.mutex };
+  shard.loading.erase(cluster);
+  promise.set_value(loaded_cluster);
+  if (!loaded_cluster) {
+    shard.failed.insert(cluster);
+    return nullptr;
+  }
+
+  // Insert cluster and evict least recently used clusters until within
+  // budget; evicted clusters still referenced by a tracing thread are
+  // freed once that thread releases them
+  shard.lru.emplace_front(cluster, loaded_cluster);
+  shard.entries.emplace(cluster, shard.lru.begin());
+  shard.resident_bytes += loaded_cluster->bytes();
+  while (shard.resident_bytes > shard_capacity_bytes_ && shard.lru.size() > 1U) {
+    const auto& [evicted_index, evicted_cluster] = shard.lru.back();
+    shard.resident_bytes -= evicted_cluster->bytes();
+    shard.entries.erase(evicted_index);
+    shard.lru.pop_back();
+    evictions_.fetch_add(1U, std::memory_order_relaxed);
+  }
+
+  return loaded_cluster;
+}
+
+std::shared_ptr<PagedGeometry::Cluster> PagedGeometry::ReadCluster(
+    std::uint32_t cluster) const {
+  const ClusterInfo& info{ clusters_[cluster] };
+  std::shared_ptr<Cluster> loaded_cluster{ std::make_shared<Cluster>() };
+
+  // Positional reads need no lock, so threads missing different clusters
+  // read them in parallel
+  std::uint64_t offset{ info.offset };
+  if (!ReadArray(*file_, offset, loaded_cluster->nodes, info.node_count)
+      || !ReadArray(*file_, offset, loaded_cluster->center_x, info.sphere_count)
+      || !ReadArray(*file_, offset, loaded_cluster->center_y, info.sphere_count)
+      || !ReadArray(*file_, offset, loaded_cluster->center_z, info.sphere_count)
+      || !ReadArray(*file_, offset, loaded_cluster->radius, info.sphere_count)
+      || !ReadArray(*file_, offset, loaded_cluster->material, info.sphere_count)) {
+    return nullptr;
+  }
+
+  // Guard against corrupt files indexing past the palette or the
+  // cluster's own spheres and nodes
+  for (const std::uint32_t material : loaded_cluster->material) {
+    if (material >= materials_.size()) {
+      return nullptr;
+    }
+  }
+  if (!ValidateWideBvh(loaded_cluster->nodes, loaded_cluster->radius.size())) {
+    return nullptr;
+  }
+
+  return loaded_cluster;
+}
@@ -0,0 +1,163 @@
+#ifndef PAGEDGEOMETRY_H
+#define PAGEDGEOMETRY_H
+
+// STL
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// src
+#include "IRayTraceable.h"
+#include "Kernels.h"
+#include "WideBvh.h"
+
+// Forward declarations
+class PositionalFile;
+class Ray;
+
+struct PagedGeometryStats {
+  std::uint64_t page_hits;
+  std::uint64_t page_faults;
+  std::uint64_t evictions;
+  std::size_t resident_clusters;
+  std::size_t resident_bytes;
+  std::size_t capacity_bytes;
+};
+
+// Sphere sets too large to keep in memory, traced straight from disk.
+//
+// Spheres are grouped into spatially compact clusters, each stored in the
+// file as a packed array of centers, radii and material indices together
+// with a wide BVH over them. Only a wide BVH over the clusters' bounds is
+// kept resident; a cluster is read in the first time a ray reaches it and
+// kept in a memory-bounded cache of independently locked LRU shards, like
+// texture tiles.
+//
+// Emissive spheres are lit by rays that hit them but are not sampled by
+// the light tree, which only covers the scene's in-memory spheres.
+//
+// Layout: a fixed-size header, the cluster data, then the index (material
+// palette, top-level nodes and cluster table) at header.index_offset.
+class PagedGeometry : public IRayTraceable {
+public:
+  static constexpr std::uint32_t kMagic{ 0x4F475452U };  // "RTGO"
+  static constexpr std::uint32_t kVersion{ 1U };
+  static constexpr std::uint32_t kClusterSize{ 4096U };
+  static constexpr std::size_t kDefaultCapacityBytes{ 1024U * 1024U * 1024U };
+
+  PagedGeometry() = delete;
+  PagedGeometry(const PagedGeometry&) = delete;
+  PagedGeometry& operator=(const PagedGeometry&) = delete;
+
+  // Opens a geometry file and reads its index; clusters are read on
+  // demand while keeping at most capacity_bytes of them resident
+  [[nodiscard]]
+  static std::shared_ptr<PagedGeometry> Open(
+    const std::filesystem::path& path,
+    std::size_t capacity_bytes = kDefaultCapacityBytes);
+
+  // Clusters spheres along a Morton curve and writes them with their
+  // hierarchies to disk; materials holds one entry per sphere
+  static bool Write(
+    const std::filesystem::path& path,
+    const SphereArrays& spheres,
+    const std::vector<Material>& materials);
+
+  [[nodiscard]]
+  std::optional<TraceResult> TraceRay(
+    const Ray& ray,
+    float min_distance,
+    float max_distance) const override;
+
+  [[nodiscard]]
+  PagedGeometryStats GetStats() const noexcept;
+
+  void LogStats() const;
+
+  [[nodiscard]]
+  std::uint64_t sphere_count() const noexcept {
+    return sphere_count_;
+  }
+
+  [[nodiscard]]
+  std::size_t cluster_count() const noexcept {
+    return clusters_.size();
+  }
+
+private:
+  struct ClusterInfo {
+    float bounds_min[3];
+    std::uint32_t node_count;
+    float bounds_max[3];
+    std::uint32_t sphere_count;
+    std::uint64_t offset;
+  };
+
+  // Resident copy of one cluster
+  struct Cluster {
+    std::vector<WideBvhNode> nodes;
+    std::vector<float> center_x;
+    std::vector<float> center_y;
+    std::vector<float> center_z;
+    std::vector<float> radius;
+    std::vector<std::uint32_t> material;
+
+    [[nodiscard]]
+    std::size_t bytes() const noexcept;
+  };
+
+  using LruList = std::list<std::pair<std::uint32_t, std::shared_ptr<const Cluster>>>;
+
+  using ClusterFuture = std::shared_future<std::shared_ptr<const Cluster>>;
+
+  struct Shard {
+    std::mutex mutex;
+    LruList lru;
+    std::unordered_map<std::uint32_t, LruList::iterator> entries;
+    // Clusters being read, so threads missing the same one share a read
+    std::unordered_map<std::uint32_t, ClusterFuture> loading;
+    // Clusters that failed to read, so they are reported once rather than
+    // read again by every ray reaching them
+    std::unordered_set<std::uint32_t> failed;
+    std::size_t resident_bytes{ 0U };
+  };
+
+  static constexpr std::size_t kShardCount{ 16U };
+
+  PagedGeometry(std::unique_ptr<const PositionalFile> file, std::size_t capacity_bytes);
+
+  // Returns the requested cluster, reading it from disk on a miss
+  [[nodiscard]]
+  std::shared_ptr<const Cluster> GetCluster(std::uint32_t cluster) const;
+
+  [[nodiscard]]
+  std::shared_ptr<Cluster> ReadCluster(std::uint32_t cluster) const;
+
+private:
+  std::unique_ptr<const PositionalFile> file_;
+
+  std::uint64_t sphere_count_;
+  std::vector<Material> materials_;
+  std::vector<WideBvhNode> nodes_;
+  std::vector<ClusterInfo> clusters_;
+
+  mutable std::array<Shard, kShardCount> shards_;
+  std::size_t shard_capacity_bytes_;
+
+  mutable std::atomic<std::uint64_t> page_hits_;
+  mutable std::atomic<std::uint64_t> page_faults_;
+  mutable std::atomic<std::uint64_t> evictions_;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "PositionalFile.h"
+
+// STL
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+// Windows
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// POSIX
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+PositionalFile::PositionalFile(NativeHandle handle) : handle_{ handle } {}
+
+PositionalFile::~PositionalFile() {
+#if defined(_WIN32)
+  CloseHandle(handle_);
+#else
+  close(handle_);
+#endif
+}
+
+std::unique_ptr<PositionalFile> PositionalFile::Open(const std::filesystem::path& path) {
+#if defined(_WIN32)
+  const HANDLE handle{
+    CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL, nullptr)
+  };
+  if (handle == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+#else
+  const int handle{ open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+  if (handle < 0) {
+    return nullptr;
+  }
+#endif
+
+  return std::unique_ptr<PositionalFile>{ new PositionalFile{ handle } };
+}
+
+bool PositionalFile::Read(std::uint64_t offset, void* data, std::size_t size) const {
+  // Reads may return fewer bytes than asked for, so continue until done
+  std::byte* destination{ static_cast<std::byte*>(data) };
+  while (size > 0U) {
+#if defined(_WIN32)
+    // The offset travels with the request rather than the handle
+    OVERLAPPED overlapped{};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32U);
+    DWORD read_size{ 0U };
+    const DWORD request_size{
+      static_cast<DWORD>(std::min<std::size_t>(size, 1U << 30U))
+    };
+    if (!ReadFile(handle_, destination, request_size, &read_size, &overlapped)
+        || read_size == 0U) {
+      return false;
+    }
+#else
+    const ssize_t read_size{
+      pread(handle_, destination, size, static_cast<off_t>(offset))
+    };
+    if (read_size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (read_size <= 0) {
+      return false;
+    }
+#endif
+
+    destination += read_size;
+    offset += static_cast<std::uint64_t>(read_size);
+    size -= static_cast<std::size_t>(read_size);
+  }
+
+  return true;
+}
+
+std::optional<std::uint64_t> PositionalFile::Size() const {
+#if defined(_WIN32)
+  LARGE_INTEGER size{};
+  if (!GetFileSizeEx(handle_, &size)) {
+    return std::nullopt;
+  }
+  return static_cast<std::uint64_t>(size.QuadPart);
+#else
+  struct stat status{};
+  if (fstat(handle_, &status) != 0) {
+    return std::nullopt;
+  }
+  return static_cast<std::uint64_t>(status.st_size);
+#endif
+}
@@ -0,0 +1,47 @@
+#ifndef POSITIONALFILE_H
+#define POSITIONALFILE_H
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+// Read-only file read at explicit offsets. There is no shared file
+// position, so any number of threads can read through one handle at once
+// without a lock.
+class PositionalFile {
+public:
+  PositionalFile() = delete;
+  PositionalFile(const PositionalFile&) = delete;
+  PositionalFile& operator=(const PositionalFile&) = delete;
+  ~PositionalFile();
+
+  // Null if the file cannot be opened
+  [[nodiscard]]
+  static std::unique_ptr<PositionalFile> Open(const std::filesystem::path& path);
+
+  // Reads exactly size bytes starting at offset; safe to call from
+  // multiple threads
+  bool Read(std::uint64_t offset, void* data, std::size_t size) const;
+
+  // Current length of the file in bytes, or nullopt if it cannot be
+  // queried
+  [[nodiscard]]
+  std::optional<std::uint64_t> Size() const;
+
+private:
+#if defined(_WIN32)
+  using NativeHandle = void*;
+#else
+  using NativeHandle = int;
+#endif
+
+  explicit PositionalFile(NativeHandle handle);
+
+private:
+  NativeHandle handle_;
+};
+
+#endif
@@ -0,0 +1,471 @@
+#include "PreviewRenderer.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// glm
+#include "glm/common.hpp"
+#include "glm/vec3.hpp"
+
+// src
+#include "JobSystem.h"
+#include "Kernels.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Sphere.h"
+
+namespace {
+
+// Coarsest level traces every 8th pixel in each direction
+constexpr std::size_t kMaxStride{ 8U };
+
+// Target duration of one chunk of work, bounding how far a frame can
+// overrun its budget
+constexpr double kChunkSeconds{ 0.001 };
+constexpr std::size_t kMinChunkSize{ 16U };
+
+// Edits clear whole tiles, aligned to the coarsest level's grid so that
+// cleared pixels fall back to coarse samples inside the same tile
+constexpr std::size_t kDirtyTileSize{ 2U * kMaxStride };
+
+// Bounds closer to the camera than this are not projected
+constexpr float kMinFootprintDepth{ 1.0e-3F };
+
+std::size_t Log2(std::size_t value) {
+  std::size_t result{ 0U };
+  while (value > 1U) {
+    value >>= 1U;
+    ++result;
+  }
+  return result;
+}
+
+}  // namespace
+
+// Cells of one pass shared by every thread working on it during a frame.
+// Jobs still queued once the frame moves on find the segment closed and
+// return without touching the renderer, so the frame never waits on
+// workers that are busy with other jobs.
+struct PreviewRenderer::PassSegment {
+  const Scene* scene;
+  Pass pass;
+  Region region;
+  std::size_t grid_width;
+  std::size_t cell_count;
+  std::size_t chunk_size;
+  std::chrono::steady_clock::time_point deadline;
+
+  std::atomic<std::size_t> next_cell;
+  std::atomic<std::size_t> samples{ 0U };
+  // Jobs inside the segment; the last one to leave notifies the frame
+  std::atomic<std::size_t> active_jobs{ 0U };
+  std::atomic<bool> closed{ false };
+};
+
+PreviewRenderer::PreviewRenderer(const RenderSettings& settings)
+    : renderer_{ settings }
+    , scene_{ nullptr }
+    , needs_restart_{ true }
+    , needs_region_restart_{ false }
+    , region_{ 0U, 0U, 0U, 0U }
+    , start_stride_{ kMaxStride }
+    , pass_{ 0U }
+    , pass_count_{ 0U }
+    , pass_cursor_{ 0U }
+    , samples_per_second_{ 0.0 }
+    , resolve_time_{ 0 } {}
+
+void PreviewRenderer::SetSettings(const RenderSettings& settings) {
+  if (settings == renderer_.settings()) {
+    return;
+  }
+
+  renderer_.Reset(settings);
+  needs_restart_ = true;
+}
+
+void PreviewRenderer::InvalidateScene() {
+  renderer_.Reset(renderer_.settings());
+  needs_restart_ = true;
+}
+
+void PreviewRenderer::InvalidateSpheres(const std::vector<Sphere>& bounds) {
+  // Everything is traced again anyway
+  if (needs_restart_) {
+    return;
+  }
+
+  // Clear the tiles under each sphere and refine the rectangle around
+  // all of them
+  std::optional<Region> dirty_region{};
+  for (const Sphere& sphere : bounds) {
+    const std::optional<Region> footprint{ ComputeFootprint(sphere) };
+    if (!footprint.has_value()) {
+      InvalidateScene();
+      return;
+    }
+    if (footprint->min_u >= footprint->max_u || footprint->min_v >= footprint->max_v) {
+      continue;
+    }
+
+    renderer_.ClearPixels(footprint->min_u, footprint->min_v,
+                          footprint->max_u, footprint->max_v);
+    if (dirty_region.has_value()) {
+      dirty_region->min_u = std::min(dirty_region->min_u, footprint->min_u);
+      dirty_region->min_v = std::min(dirty_region->min_v, footprint->min_v);
+      dirty_region->max_u = std::max(dirty_region->max_u, footprint->max_u);
+      dirty_region->max_v = std::max(dirty_region->max_v, footprint->max_v);
+    } else {
+      dirty_region = footprint;
+    }
+  }
+  if (!dirty_region.has_value()) {
+    return;
+  }
+
+  // Keep refining the tiles of an earlier edit that have not caught up
+  if (!needs_region_restart_ && (converged() || IsFullImage(region_))) {
+    region_ = dirty_region.value();
+  } else {
+    region_.min_u = std::min(region_.min_u, dirty_region->min_u);
+    region_.min_v = std::min(region_.min_v, dirty_region->min_v);
+    region_.max_u = std::max(region_.max_u, dirty_region->max_u);
+    region_.max_v = std::max(region_.max_v, dirty_region->max_v);
+  }
+  needs_region_restart_ = true;
+}
+
+bool PreviewRenderer::Render(
+    const std::shared_ptr<const Scene>& scene,
+    JobSystem& jobs,
+    std::chrono::nanoseconds budget) {
+  const std::chrono::steady_clock::time_point start_time{
+    std::chrono::steady_clock::now()
+  };
+
+  // Start over whenever a different scene is published
+  if (!scene) {
+    return false;
+  }
+  if (scene != scene_) {
+    scene_ = scene;
+    renderer_.Reset(renderer_.settings());
+    needs_restart_ = true;
+  }
+
+  const RenderSettings& settings{ renderer_.settings() };
+  if (settings.image_width == 0U || settings.image_height == 0U) {
+    return false;
+  }
+  if (needs_restart_) {
+    Restart(budget);
+    needs_restart_ = false;
+    needs_region_restart_ = false;
+  } else if (needs_region_restart_) {
+    RestartRegion(budget);
+    needs_region_restart_ = false;
+  }
+  if (converged()) {
+    return false;
+  }
+
+  // Leave enough of the budget to resolve the display image afterwards,
+  // but never more than half of it, so a slow resolve cannot crowd out
+  // sampling altogether
+  const std::chrono::steady_clock::time_point deadline{
+    start_time + budget - std::min(resolve_time_, budget / 2)
+  };
+  const std::size_t thread_count{ jobs.thread_count() + 1U };
+  const std::size_t chunk_size{
+    std::max(kMinChunkSize,
+             static_cast<std::size_t>(samples_per_second_ * kChunkSeconds
+                                      / static_cast<double>(thread_count)))
+  };
+
+  // Work through passes until time runs out; each pass is finished by all
+  // threads before the next one starts, so no pixel is traced twice at once
+  // The first segment always runs and traces at least one chunk on this
+  // thread, so every frame makes progress even if the deadline has passed
+  std::size_t sample_count{ 0U };
+  bool first_segment{ true };
+  while (!converged() && (first_segment || std::chrono::steady_clock::now() < deadline)) {
+    const Pass pass{ GetPass(pass_) };
+    const std::size_t cell_count{ CountPassCells(pass.stride) };
+
+    const std::shared_ptr<PassSegment> segment{ std::make_shared<PassSegment>() };
+    segment->scene = scene_.get();
+    segment->pass = pass;
+    segment->region = region_;
+    segment->grid_width = (region_.max_u - region_.min_u + pass.stride - 1U) / pass.stride;
+    segment->cell_count = cell_count;
+    segment->chunk_size = chunk_size;
+    segment->deadline = deadline;
+    segment->next_cell.store(pass_cursor_);
+
+    for (std::size_t i{ 0U }; i < jobs.thread_count(); ++i) {
+      jobs.Submit([this, segment]() {
+        segment->active_jobs.fetch_add(1U);
+        if (!segment->closed.load()) {
+          segment->samples.fetch_add(RunPassSegment(*segment, false));
+        }
+        if (segment->active_jobs.fetch_sub(1U) == 1U) {
+          segment->active_jobs.notify_all();
+        }
+      });
+    }
+    sample_count += RunPassSegment(*segment, first_segment);
+    first_segment = false;
+
+    // Retire jobs that have not started and wait for the running ones,
+    // which stop claiming cells at the deadline
+    segment->closed.store(true);
+    for (std::size_t active{ segment->active_jobs.load() }; active > 0U;
+         active = segment->active_jobs.load()) {
+      segment->active_jobs.wait(active);
+    }
+    sample_count += segment->samples.load();
+
+    pass_cursor_ = std::min(segment->next_cell.load(), cell_count);
+    if (pass_cursor_ == cell_count) {
+      ++pass_;
+      pass_cursor_ = 0U;
+    }
+
+    // Once edited tiles have caught up, carry on with the rest of the image
+    if (converged() && !IsFullImage(region_)) {
+      ContinueFullImage();
+    }
+  }
+
+  // Update the sample rate estimate used to pick levels and chunk sizes
+  const std::chrono::duration<double> sampling_time{
+    std::chrono::steady_clock::now() - start_time
+  };
+  if (sample_count > 0U && sampling_time.count() > 0.0) {
+    const double rate{ static_cast<double>(sample_count) / sampling_time.count() };
+    samples_per_second_ = samples_per_second_ > 0.0
+                            ? 0.5 * (samples_per_second_ + rate)
+                            : rate;
+  }
+  if (sample_count == 0U) {
+    return false;
+  }
+
+  const std::chrono::steady_clock::time_point resolve_start_time{
+    std::chrono::steady_clock::now()
+  };
+  ResolveDisplay();
+  resolve_time_ = std::chrono::steady_clock::now() - resolve_start_time;
+
+  return true;
+}
+
+std::size_t PreviewRenderer::current_stride() const noexcept {
+  return converged() ? 1U : GetPass(pass_).stride;
+}
+
+void PreviewRenderer::Restart(std::chrono::nanoseconds budget) {
+  const RenderSettings& settings{ renderer_.settings() };
+  const std::size_t pixel_count{ settings.image_width * settings.image_height };
+
+  // Keep showing the previous image until it is overdrawn, unless the
+  // size changed
+  if (display_.size() != 4U * pixel_count) {
+    display_.assign(4U * pixel_count, 0U);
+    for (std::size_t i{ 3U }; i < display_.size(); i += 4U) {
+      display_[i] = 255U;
+    }
+  }
+
+  // Measure the resolve again, since its cost depends on the image size
+  resolve_time_ = std::chrono::nanoseconds{ 0 };
+
+  region_ = Region{ 0U, 0U, settings.image_width, settings.image_height };
+  RestartRegion(budget);
+}
+
+void PreviewRenderer::RestartRegion(std::chrono::nanoseconds budget) {
+  const RenderSettings& settings{ renderer_.settings() };
+
+  // Start at the finest level that can be covered within one frame
+  start_stride_ = kMaxStride;
+  if (samples_per_second_ > 0.0) {
+    const std::chrono::duration<double> budget_seconds{ budget };
+    for (std::size_t stride{ 1U }; stride < kMaxStride; stride *= 2U) {
+      const double pass_seconds{
+        static_cast<double>(CountPassCells(stride)) / samples_per_second_
+      };
+      if (pass_seconds <= budget_seconds.count()) {
+        start_stride_ = stride;
+        break;
+      }
+    }
+  }
+
+  pass_ = 0U;
+  pass_count_ = Log2(start_stride_) + settings.samples_per_pixel;
+  pass_cursor_ = 0U;
+}
+
+void PreviewRenderer::ContinueFullImage() {
+  const RenderSettings& settings{ renderer_.settings() };
+  region_ = Region{ 0U, 0U, settings.image_width, settings.image_height };
+
+  // Pixels without any sample are left if the edit came before the
+  // pyramid reached full resolution, so its levels are walked again
+  const std::uint32_t min_samples{ std::ranges::min(renderer_.sample_counts()) };
+  if (min_samples == 0U) {
+    start_stride_ = kMaxStride;
+    pass_ = 0U;
+  } else {
+    pass_ = Log2(start_stride_) + min_samples;
+  }
+  pass_count_ = Log2(start_stride_) + settings.samples_per_pixel;
+  pass_cursor_ = 0U;
+}
+
+std::optional<PreviewRenderer::Region> PreviewRenderer::ComputeFootprint(
+    const Sphere& sphere) const {
+  const RenderSettings& settings{ renderer_.settings() };
+  const glm::vec3 offset{ sphere.center() - settings.camera_position };
+  const float radius{ sphere.radius() };
+
+  // The camera looks down -z; bounds reaching behind it do not project
+  if (-(offset.z + radius) < kMinFootprintDepth) {
+    return std::nullopt;
+  }
+
+  // Project the corners of the sphere's bounding box
+  const float image_width{ static_cast<float>(settings.image_width) };
+  const float image_height{ static_cast<float>(settings.image_height) };
+  const float viewport_width{ settings.viewport_height * (image_width / image_height) };
+  float min_u{ std::numeric_limits<float>::infinity() };
+  float min_v{ std::numeric_limits<float>::infinity() };
+  float max_u{ -std::numeric_limits<float>::infinity() };
+  float max_v{ -std::numeric_limits<float>::infinity() };
+  for (std::size_t corner{ 0U }; corner < 8U; ++corner) {
+    const glm::vec3 point{
+      offset + radius * glm::vec3{ (corner & 1U) != 0U ? 1.0F : -1.0F,
+                                   (corner & 2U) != 0U ? 1.0F : -1.0F,
+                                   (corner & 4U) != 0U ? 1.0F : -1.0F }
+    };
+    const float scale{ settings.focal_length / -point.z };
+    const float u{ (point.x * scale / viewport_width + 0.5F) * image_width };
+    const float v{ (0.5F - point.y * scale / settings.viewport_height) * image_height };
+    min_u = std::min(min_u, u);
+    min_v = std::min(min_v, v);
+    max_u = std::max(max_u, u);
+    max_v = std::max(max_v, v);
+  }
+
+  // Widen by a pixel for jittered samples and round out to whole tiles
+  const auto tile_start = [](float coordinate, float size) {
+    const std::size_t pixel{
+      static_cast<std::size_t>(std::clamp(std::floor(coordinate) - 1.0F, 0.0F, size))
+    };
+    return pixel / kDirtyTileSize * kDirtyTileSize;
+  };
+  const auto tile_end = [](float coordinate, float size, std::size_t limit) {
+    const std::size_t pixel{
+      static_cast<std::size_t>(std::clamp(std::ceil(coordinate) + 1.0F, 0.0F, size))
+    };
+    return std::min((pixel + kDirtyTileSize - 1U) / kDirtyTileSize * kDirtyTileSize, limit);
+  };
+  return Region{
+    tile_start(min_u, image_width),
+    tile_start(min_v, image_height),
+    tile_end(max_u, image_width, settings.image_width),
+    tile_end(max_v, image_height, settings.image_height)
+  };
+}
+
+bool PreviewRenderer::IsFullImage(const Region& region) const noexcept {
+  const RenderSettings& settings{ renderer_.settings() };
+  return region.min_u == 0U && region.min_v == 0U
+         && region.max_u == settings.image_width && region.max_v == settings.image_height;
+}
+
+PreviewRenderer::Pass PreviewRenderer::GetPass(std::size_t pass) const noexcept {
+  // Pyramid levels halve the stride until full resolution is reached,
+  // each sampling the pixels coarser levels have not, after which every
+  // pass adds one more sample to every pixel
+  const std::size_t level_count{ Log2(start_stride_) };
+  if (pass <= level_count) {
+    return Pass{ start_stride_ >> pass, 1U };
+  }
+
+  return Pass{ 1U, static_cast<std::uint32_t>(pass - level_count + 1U) };
+}
+
+std::size_t PreviewRenderer::CountPassCells(std::size_t stride) const noexcept {
+  return ((region_.max_u - region_.min_u + stride - 1U) / stride)
+         * ((region_.max_v - region_.min_v + stride - 1U) / stride);
+}
+
+std::size_t PreviewRenderer::RunPassSegment(PassSegment& segment, bool claim_first_chunk) {
+  const std::size_t stride{ segment.pass.stride };
+  const std::size_t image_width{ renderer_.settings().image_width };
+  const std::vector<std::uint32_t>& sample_counts{ renderer_.sample_counts() };
+
+  std::size_t sample_count{ 0U };
+  for (bool claim{ claim_first_chunk };
+       claim || std::chrono::steady_clock::now() < segment.deadline; claim = false) {
+    // Claim the next chunk of cells
+    const std::size_t first_cell{
+      segment.next_cell.fetch_add(segment.chunk_size, std::memory_order_relaxed)
+    };
+    if (first_cell >= segment.cell_count) {
+      break;
+    }
+    const std::size_t last_cell{
+      std::min(first_cell + segment.chunk_size, segment.cell_count)
+    };
+
+    for (std::size_t cell{ first_cell }; cell < last_cell; ++cell) {
+      const std::size_t u{ segment.region.min_u + (cell % segment.grid_width) * stride };
+      const std::size_t v{ segment.region.min_v + (cell / segment.grid_width) * stride };
+      if (sample_counts[image_width * v + u] >= segment.pass.target_samples) {
+        continue;
+      }
+
+      renderer_.AccumulateSample(*segment.scene, u, v);
+      ++sample_count;
+    }
+  }
+
+  return sample_count;
+}
+
+void PreviewRenderer::ResolveDisplay() {
+  const KernelTable& kernels{ GetKernels() };
+  const RenderSettings& settings{ renderer_.settings() };
+  const std::vector<float>& accumulation{ renderer_.accumulation() };
+  const std::vector<std::uint32_t>& sample_counts{ renderer_.sample_counts() };
+
+  for (std::size_t v{ 0U }; v < settings.image_height; ++v) {
+    for (std::size_t u{ 0U }; u < settings.image_width; ++u) {
+      // Fall back to the nearest coarser sample for pixels without one
+      std::size_t source_pixel{ settings.image_width * v + u };
+      for (std::size_t stride{ 2U };
+           sample_counts[source_pixel] == 0U && stride <= start_stride_;
+           stride *= 2U) {
+        source_pixel = settings.image_width * (v & ~(stride - 1U)) + (u & ~(stride - 1U));
+      }
+      if (sample_counts[source_pixel] == 0U) {
+        continue;
+      }
+
+      kernels.tonemap(accumulation.data() + 3U * source_pixel, 3U,
+                      1.0F / static_cast<float>(sample_counts[source_pixel]),
+                      display_.data() + 4U * (settings.image_width * v + u));
+    }
+  }
+}
@@ -0,0 +1,156 @@
+#ifndef PREVIEWRENDERER_H
+#define PREVIEWRENDERER_H
+
+// STL
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// src
+#include "Renderer.h"
+
+// Forward declarations
+class JobSystem;
+class Scene;
+class Sphere;
+
+// Progressive renderer for interactive views that must produce an image
+// within a fixed time budget every frame.
+//
+// After the camera, image size or scene changes, the image is refined
+// through a resolution pyramid: one sample for every 8th, then every 4th
+// and 2nd pixel, and finally every pixel, with each level only tracing
+// the pixels the coarser levels have not already sampled. Pixels without
+// a sample of their own show the nearest coarser one. Once every pixel is
+// covered, further passes keep adding samples until samples_per_pixel is
+// reached. The starting level is picked from the measured sample rate, so
+// cheap scenes skip straight to a fine level while heavy ones stay
+// responsive.
+//
+// Passes skip pixels that already have the samples they would add, so
+// after a localized edit only the tiles it covers are cleared and refined
+// through the pyramid again, while converged pixels elsewhere are kept.
+class PreviewRenderer {
+public:
+  PreviewRenderer() = delete;
+  explicit PreviewRenderer(const RenderSettings& settings);
+
+  // Restarts the pyramid if the settings differ from the current ones
+  void SetSettings(const RenderSettings& settings);
+
+  // Restarts the pyramid after the current scene was edited in place
+  void InvalidateScene();
+
+  // Restarts only the tiles covering the screen footprint of the given
+  // bounds, e.g. an edited object's old and new bounding spheres, after
+  // the scene was edited in place. Changes to lighting outside that
+  // footprint, such as shadows and reflections, are not picked up unless
+  // the bounds are widened to include them. Falls back to
+  // InvalidateScene() if a sphere reaches behind the camera.
+  void InvalidateSpheres(const std::vector<Sphere>& bounds);
+
+  // Issues work until the budget runs out or the image has converged;
+  // returns true if the display image changed
+  bool Render(
+    const std::shared_ptr<const Scene>& scene,
+    JobSystem& jobs,
+    std::chrono::nanoseconds budget);
+
+  [[nodiscard]]
+  const RenderSettings& settings() const noexcept {
+    return renderer_.settings();
+  }
+
+  // Tonemapped RGBA8 image, row-major
+  [[nodiscard]]
+  const std::vector<std::uint8_t>& display() const noexcept {
+    return display_;
+  }
+
+  // Pixel spacing of the level being refined; 1 once at full resolution
+  [[nodiscard]]
+  std::size_t current_stride() const noexcept;
+
+  [[nodiscard]]
+  bool converged() const noexcept {
+    return pass_ >= pass_count_;
+  }
+
+  // Camera rays traced per second across all threads
+  [[nodiscard]]
+  double samples_per_second() const noexcept {
+    return samples_per_second_;
+  }
+
+private:
+  struct Pass {
+    std::size_t stride;
+    // Cells whose pixel already has this many samples are skipped, such
+    // as those sampled by a coarser level
+    std::uint32_t target_samples;
+  };
+
+  // Rectangle of pixels [min_u, max_u) x [min_v, max_v)
+  struct Region {
+    std::size_t min_u;
+    std::size_t min_v;
+    std::size_t max_u;
+    std::size_t max_v;
+  };
+
+  struct PassSegment;
+
+  // Starts over from the coarsest level whose pixels fit in the budget,
+  // over the whole image or only over region_
+  void Restart(std::chrono::nanoseconds budget);
+  void RestartRegion(std::chrono::nanoseconds budget);
+
+  // Continues with the whole image once region_ has converged, from the
+  // first pass that still has pixels to sample
+  void ContinueFullImage();
+
+  // Pixels a sphere can cover, in whole tiles; empty if it is off screen,
+  // or nullopt if it reaches behind the camera
+  [[nodiscard]]
+  std::optional<Region> ComputeFootprint(const Sphere& sphere) const;
+
+  [[nodiscard]]
+  bool IsFullImage(const Region& region) const noexcept;
+
+  [[nodiscard]]
+  Pass GetPass(std::size_t pass) const noexcept;
+
+  [[nodiscard]]
+  std::size_t CountPassCells(std::size_t stride) const noexcept;
+
+  // Traces claimed chunks of the segment's cells until they run out or
+  // the segment's deadline passes, claiming at least one chunk if asked
+  // to; returns the number of samples traced
+  std::size_t RunPassSegment(PassSegment& segment, bool claim_first_chunk);
+
+  // Tonemaps accumulated samples into the display image
+  void ResolveDisplay();
+
+private:
+  Renderer renderer_;
+  std::shared_ptr<const Scene> scene_;
+  bool needs_restart_;
+  bool needs_region_restart_;
+  // Pixels the current passes cover
+  Region region_;
+
+  std::vector<std::uint8_t> display_;
+
+  std::size_t start_stride_;
+  std::size_t pass_;
+  std::size_t pass_count_;
+  std::size_t pass_cursor_;
+
+  double samples_per_second_;
+  std::chrono::nanoseconds resolve_time_;
+};
+
+#endif
@@ -0,0 +1,437 @@
+#include "RenderServer.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// POSIX
+#if !defined(_WIN32)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// glm
+#include "glm/vec3.hpp"
+
+// nlohmann
+#include "nlohmann/json.hpp"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// src
+#include "JobSystem.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "SceneCache.h"
+
+namespace {
+
+using Json = nlohmann::json;
+
+// Requests longer than this are rejected rather than buffered
+constexpr std::size_t kMaxRequestBytes{ 1024U * 1024U };
+constexpr std::size_t kMaxImageSize{ 16384U };
+
+// Budgets keeping a single request from exhausting memory, about 1 GiB
+// of per-pixel buffers, or occupying a worker for hours
+constexpr std::size_t kMaxImagePixels{ 32U * 1024U * 1024U };
+constexpr std::size_t kMaxPathCount{ std::size_t{ 1U } << 34U };
+constexpr std::size_t kMaxDepth{ 256U };
+
+// How often blocked threads check whether the server is stopping
+constexpr int kPollIntervalMilliseconds{ 200 };
+
+// Set from signal handlers, so it must be lock-free
+std::atomic<bool> stop_signal_received{ false };
+static_assert(std::atomic<bool>::is_always_lock_free);
+
+void HandleStopSignal(int) {
+  stop_signal_received.store(true);
+}
+
+struct RenderJobResult {
+  std::string error;
+  double render_seconds;
+  std::vector<std::uint8_t> pixels;
+};
+
+std::string EncodeBase64(const std::vector<std::uint8_t>& bytes) {
+  constexpr std::string_view alphabet{
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+  };
+
+  std::string encoded{};
+  encoded.reserve(4U * ((bytes.size() + 2U) / 3U));
+  for (std::size_t i{ 0U }; i < bytes.size(); i += 3U) {
+    const std::size_t remaining{ bytes.size() - i };
+    const std::uint32_t group{
+      (static_cast<std::uint32_t>(bytes[i]) << 16U)
+      | (remaining > 1U ? static_cast<std::uint32_t>(bytes[i + 1U]) << 8U : 0U)
+      | (remaining > 2U ? static_cast<std::uint32_t>(bytes[i + 2U]) : 0U)
+    };
+    encoded += alphabet[(group >> 18U) & 0x3FU];
+    encoded += alphabet[(group >> 12U) & 0x3FU];
+    encoded += remaining > 1U ? alphabet[(group >> 6U) & 0x3FU] : '=';
+    encoded += remaining > 2U ? alphabet[group & 0x3FU] : '=';
+  }
+
+  return encoded;
+}
+
+// Optional request fields keep their default if absent and fail if
+// present with the wrong type
+bool ReadSize(const Json& request, const char* key, std::size_t& value) {
+  const auto field{ request.find(key) };
+  if (field == request.end()) {
+    return true;
+  }
+  if (!field->is_number_unsigned()) {
+    return false;
+  }
+  value = field->get<std::size_t>();
+  return true;
+}
+
+// Numbers beyond the range of float become infinite rather than
+// overflowing the conversion, so the range checks reject them
+float ToFloat(const Json& number) {
+  const double value{ number.get<double>() };
+  if (std::abs(value) > static_cast<double>(std::numeric_limits<float>::max())) {
+    return value < 0.0 ? -std::numeric_limits<float>::infinity()
+                       : std::numeric_limits<float>::infinity();
+  }
+  return static_cast<float>(value);
+}
+
+bool ReadFloat(const Json& request, const char* key, float& value) {
+  const auto field{ request.find(key) };
+  if (field == request.end()) {
+    return true;
+  }
+  if (!field->is_number()) {
+    return false;
+  }
+  value = ToFloat(*field);
+  return true;
+}
+
+bool ReadVec3(const Json& request, const char* key, glm::vec3& value) {
+  const auto field{ request.find(key) };
+  if (field == request.end()) {
+    return true;
+  }
+  if (!field->is_array() || field->size() != 3U
+      || !std::all_of(field->begin(), field->end(),
+                      [](const Json& component) { return component.is_number(); })) {
+    return false;
+  }
+  value = glm::vec3{
+    ToFloat((*field)[0]), ToFloat((*field)[1]), ToFloat((*field)[2])
+  };
+  return true;
+}
+
+bool ReadString(const Json& request, const char* key, std::string& value) {
+  const auto field{ request.find(key) };
+  if (field == request.end()) {
+    return true;
+  }
+  if (!field->is_string()) {
+    return false;
+  }
+  value = field->get<std::string>();
+  return true;
+}
+
+std::string MakeErrorReply(Json& reply, std::string_view error) {
+  reply["status"] = "error";
+  reply["error"] = error;
+  return reply.dump(-1, ' ', false, Json::error_handler_t::replace);
+}
+
+#if !defined(_WIN32)
+bool SendAll(int socket, std::string_view data) {
+  while (!data.empty()) {
+    const ssize_t sent{ send(socket, data.data(), data.size(), 0) };
+    if (sent <= 0) {
+      return false;
+    }
+    data.remove_prefix(static_cast<std::size_t>(sent));
+  }
+  return true;
+}
+#endif
+
+}  // namespace
+
+RenderServer::RenderServer(JobSystem& jobs, std::size_t scene_cache_capacity)
+    : jobs_{ jobs }
+    , scene_cache_{ jobs, scene_cache_capacity }
+    , stop_requested_{ false } {}
+
+bool RenderServer::Run(const std::filesystem::path& socket_path) {
+#if defined(_WIN32)
+  spdlog::error("Server mode needs Unix domain sockets, which are not supported here; "
+                "cannot serve {}.", socket_path.string());
+  return false;
+#else
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  const std::string path_string{ socket_path.string() };
+  if (path_string.empty() || path_string.size() >= sizeof(address.sun_path)) {
+    spdlog::error("Socket path {} is empty or too long.", path_string);
+    return false;
+  }
+  std::copy(path_string.begin(), path_string.end(), address.sun_path);
+
+  const int listener{ socket(AF_UNIX, SOCK_STREAM, 0) };
+  if (listener < 0) {
+    spdlog::error("Failed to create socket.");
+    return false;
+  }
+
+  // Replace a socket left behind by a previous run
+  std::error_code error{};
+  std::filesystem::remove(socket_path, error);
+  if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+      || listen(listener, SOMAXCONN) != 0) {
+    spdlog::error("Failed to listen on {}.", path_string);
+    close(listener);
+    return false;
+  }
+
+  // Stop cleanly on interrupt, and report closed connections as failed
+  // sends rather than dying on SIGPIPE
+  std::signal(SIGINT, HandleStopSignal);
+  std::signal(SIGTERM, HandleStopSignal);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  spdlog::info("Serving renders on {} with {} worker threads.",
+               path_string, jobs_.thread_count());
+
+  // Accept connections until stopped, forgetting those that have closed
+  std::vector<std::future<void>> connections{};
+  while (!stop_requested_.load() && !stop_signal_received.load()) {
+    std::erase_if(connections, [](const std::future<void>& connection) {
+      return connection.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready;
+    });
+
+    pollfd listener_poll{ listener, POLLIN, 0 };
+    if (poll(&listener_poll, 1U, kPollIntervalMilliseconds) <= 0) {
+      continue;
+    }
+    const int client{ accept(listener, nullptr, nullptr) };
+    if (client >= 0) {
+      connections.emplace_back(std::async(std::launch::async, [this, client]() {
+        ServeConnection(client);
+      }));
+    }
+  }
+
+  // Let connections finish the request they are working on
+  stop_requested_.store(true);
+  connections.clear();
+  close(listener);
+  std::filesystem::remove(socket_path, error);
+
+  spdlog::info("Server stopped.");
+  return true;
+#endif
+}
+
+void RenderServer::ServeConnection([[maybe_unused]] int client) {
+#if !defined(_WIN32)
+  std::string buffer{};
+  char chunk[4096];
+  while (!stop_requested_.load() && !stop_signal_received.load()) {
+    pollfd client_poll{ client, POLLIN, 0 };
+    const int ready{ poll(&client_poll, 1U, kPollIntervalMilliseconds) };
+    if (ready < 0) {
+      break;
+    }
+    if (ready == 0) {
+      continue;
+    }
+
+    const ssize_t received{ recv(client, chunk, sizeof(chunk), 0) };
+    if (received <= 0) {
+      break;
+    }
+    buffer.append(chunk, static_cast<std::size_t>(received));
+
+    // Reply to every complete line, in order
+    bool connected{ true };
+    for (std::size_t newline{ buffer.find('\n') };
+         connected && newline != std::string::npos;
+         newline = buffer.find('\n')) {
+      std::string reply{ HandleRequest(std::string_view{ buffer }.substr(0U, newline)) };
+      reply += '\n';
+      buffer.erase(0U, newline + 1U);
+      connected = SendAll(client, reply);
+    }
+    if (!connected) {
+      break;
+    }
+
+    if (buffer.size() > kMaxRequestBytes) {
+      Json reply{};
+      SendAll(client, MakeErrorReply(reply, "Request is too long.") + '\n');
+      break;
+    }
+  }
+
+  close(client);
+#endif
+}
+
+std::string RenderServer::HandleRequest(std::string_view line) {
+  Json reply{};
+  // Braces would wrap the parsed value in a one-element array
+  const Json request = Json::parse(line, nullptr, false);
+  if (request.is_discarded() || !request.is_object()) {
+    return MakeErrorReply(reply, "Request is not a JSON object.");
+  }
+  if (const auto id{ request.find("id") }; id != request.end()) {
+    reply["id"] = *id;
+  }
+
+  std::string command{ "render" };
+  if (!ReadString(request, "command", command)) {
+    return MakeErrorReply(reply, "\"command\" must be a string.");
+  }
+
+  if (command == "stats") {
+    const SceneCacheStats stats{ scene_cache_.GetStats() };
+    reply["status"] = "ok";
+    reply["scene_cache"] = Json{
+      { "hits", stats.hits },
+      { "misses", stats.misses },
+      { "evictions", stats.evictions },
+      { "resident", stats.resident_scenes },
+      { "capacity", stats.capacity }
+    };
+    return reply.dump(-1, ' ', false, Json::error_handler_t::replace);
+  }
+
+  if (command == "shutdown") {
+    spdlog::info("Shutdown requested by client.");
+    stop_requested_.store(true);
+    reply["status"] = "ok";
+    return reply.dump(-1, ' ', false, Json::error_handler_t::replace);
+  }
+
+  if (command != "render") {
+    return MakeErrorReply(reply, "Unknown command \"" + command + "\".");
+  }
+
+  // Read the job, starting from the default settings
+  std::string scene_path{};
+  std::string output_path{};
+  RenderSettings settings{};
+  std::size_t seed{ settings.seed };
+  if (!ReadString(request, "scene", scene_path) || scene_path.empty()) {
+    return MakeErrorReply(reply, "\"scene\" must be a path.");
+  }
+  if (!ReadString(request, "output", output_path)
+      || !ReadSize(request, "width", settings.image_width)
+      || !ReadSize(request, "height", settings.image_height)
+      || !ReadSize(request, "spp", settings.samples_per_pixel)
+      || !ReadSize(request, "max_depth", settings.max_depth)
+      || !ReadSize(request, "seed", seed)
+      || !ReadVec3(request, "camera_position", settings.camera_position)
+      || !ReadFloat(request, "focal_length", settings.focal_length)
+      || !ReadFloat(request, "viewport_height", settings.viewport_height)) {
+    return MakeErrorReply(reply, "Request has a field of the wrong type.");
+  }
+  if (settings.image_width == 0U || settings.image_width > kMaxImageSize
+      || settings.image_height == 0U || settings.image_height > kMaxImageSize
+      || settings.samples_per_pixel == 0U
+      || settings.max_depth == 0U || settings.max_depth > kMaxDepth
+      || seed > std::numeric_limits<std::uint32_t>::max()
+      || !std::isfinite(settings.camera_position.x)
+      || !std::isfinite(settings.camera_position.y)
+      || !std::isfinite(settings.camera_position.z)
+      || !std::isfinite(settings.focal_length) || settings.focal_length <= 0.0F
+      || !std::isfinite(settings.viewport_height) || settings.viewport_height <= 0.0F) {
+    return MakeErrorReply(reply, "Request has a field out of range.");
+  }
+  const std::size_t pixel_count{ settings.image_width * settings.image_height };
+  if (pixel_count > kMaxImagePixels
+      || settings.samples_per_pixel > kMaxPathCount / pixel_count) {
+    return MakeErrorReply(reply, "Request exceeds the render budget.");
+  }
+  settings.seed = static_cast<std::uint32_t>(seed);
+
+  // Resolve the scene on this connection thread. Loading helps with the
+  // BVH build jobs and may wait for another connection's load of the same
+  // scene, neither of which a pool job may do.
+  bool scene_cached{ false };
+  const std::shared_ptr<const Scene> scene{ scene_cache_.Get(scene_path, &scene_cached) };
+  if (!scene) {
+    return MakeErrorReply(reply, "Failed to load scene " + scene_path + ".");
+  }
+
+  // Render on the shared pool; this connection waits for its own job
+  std::promise<RenderJobResult> result_promise{};
+  std::future<RenderJobResult> result_future{ result_promise.get_future() };
+  jobs_.Submit([&]() {
+    // Exceptions must not escape the job, and the request needs an answer
+    // even if allocating the image fails
+    RenderJobResult result{};
+    try {
+      const std::chrono::steady_clock::time_point start_time{
+        std::chrono::steady_clock::now()
+      };
+      Renderer renderer{ settings };
+      renderer.Render(*scene);
+      result.render_seconds = std::chrono::duration<double>{
+        std::chrono::steady_clock::now() - start_time
+      }.count();
+
+      if (output_path.empty()) {
+        result.pixels = renderer.ResolveImage();
+      } else if (!renderer.WriteImage(output_path)) {
+        result.error = "Failed to write image " + output_path + ".";
+      }
+    } catch (const std::exception& exception) {
+      result = RenderJobResult{};
+      result.error = std::string{ "Render failed: " } + exception.what();
+    }
+    result_promise.set_value(std::move(result));
+  });
+  const RenderJobResult result{ result_future.get() };
+  if (!result.error.empty()) {
+    return MakeErrorReply(reply, result.error);
+  }
+
+  spdlog::info("Rendered {} in {:.2f} seconds{}.", scene_path, result.render_seconds,
+               scene_cached ? " from the scene cache" : "");
+  reply["status"] = "ok";
+  reply["scene_cached"] = scene_cached;
+  reply["render_seconds"] = result.render_seconds;
+  if (output_path.empty()) {
+    reply["width"] = settings.image_width;
+    reply["height"] = settings.image_height;
+    reply["pixels"] = EncodeBase64(result.pixels);
+  } else {
+    reply["output"] = output_path;
+  }
+  return reply.dump(-1, ' ', false, Json::error_handler_t::replace);
+}
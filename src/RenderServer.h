@@ -0,0 +1,68 @@
+#ifndef RENDERSERVER_H
+#define RENDERSERVER_H
+
+// STL
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// src
+#include "SceneCache.h"
+
+// Forward declarations
+class JobSystem;
+
+// Long-running render service accepting jobs over a Unix domain socket.
+//
+// Clients send one JSON object per line and receive one JSON object per
+// line in reply, in request order. Each connection is served by its own
+// thread, which resolves the scene before its render runs on the shared
+// job system, so jobs from different connections render concurrently.
+// Scenes stay loaded in a SceneCache between jobs.
+//
+// Render requests:
+//
+//   {"id": any, "scene": "<path>", "output": "<path.ppm>",
+//    "width": 1280, "height": 720, "spp": 100, "max_depth": 10,
+//    "seed": 0, "camera_position": [0, 0, 0], "focal_length": 1,
+//    "viewport_height": 2}
+//
+// Everything but "scene" is optional. Without "output", the image is
+// returned in the reply as base64-encoded 8-bit RGB under "pixels".
+// Requests over 32 Mpixels or 2^34 paths in total are rejected, as are
+// depths beyond 256 bounces and cameras that are not finite or have a
+// non-positive focal length or viewport height.
+// Replies carry the request's "id", "status" ("ok" or "error"), an
+// "error" message on failure, and "scene_cached" and "render_seconds"
+// on success.
+//
+// {"command": "stats"} returns scene cache statistics and
+// {"command": "shutdown"} stops the server once current jobs finish.
+class RenderServer {
+public:
+  RenderServer() = delete;
+  RenderServer(JobSystem& jobs, std::size_t scene_cache_capacity);
+
+  RenderServer(const RenderServer&) = delete;
+  RenderServer& operator=(const RenderServer&) = delete;
+
+  // Serves clients at socket_path until shut down by a client, SIGINT or
+  // SIGTERM; returns false if the socket could not be set up
+  bool Run(const std::filesystem::path& socket_path);
+
+private:
+  void ServeConnection(int client);
+
+  // Handles one request line and returns the reply line
+  [[nodiscard]]
+  std::string HandleRequest(std::string_view line);
+
+private:
+  JobSystem& jobs_;
+  SceneCache scene_cache_;
+  std::atomic<bool> stop_requested_;
+};
+
+#endif
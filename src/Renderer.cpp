@@ -0,0 +1,827 @@
+#include "Renderer.h"
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+// Windows
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// POSIX
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// glm
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// src
+#include "EnvironmentMap.h"
+#include "IRayTraceable.h"
+#include "Kernels.h"
+#include "LightTree.h"
+#include "Ray.h"
+#include "Sampling.h"
+#include "Scene.h"
+#include "SpaceFillingCurve.h"
+#include "TextureCache.h"
+
+namespace {
+
+// Offsets secondary rays to avoid self-intersection
+constexpr float kRayEpsilon{ 0.001F };
+
+// Paths traced together; their pixels come from one contiguous stretch of
+// the pixel order, and between bounces the survivors are binned together
+constexpr std::size_t kPathBatchSize{ 4096U };
+
+// Side length of the square tiles the curves order the image by
+constexpr std::uint32_t kTileSize{ 16U };
+
+// Resolution of the grid secondary ray origins are binned on, per axis
+constexpr std::uint32_t kBinGridBits{ 9U };
+
+// Spread angle of the ray cone after a diffuse bounce. Scattered rays
+// cover the whole hemisphere, so textures seen through them only need
+// coarse mip levels.
+constexpr float kDiffuseConeSpread{ 0.1F };
+
+// "RTCK" in little-endian byte order
+constexpr std::uint32_t kCheckpointMagic{ 0x4B435452U };
+constexpr std::uint32_t kCheckpointVersion{ 2U };
+
+// Followed by the per-pixel sample counts and then the accumulation buffer.
+// The scene and everything that changes which random numbers or rays a
+// sample uses are stored so a checkpoint cannot be resumed with different
+// settings.
+struct CheckpointHeader {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t width;
+  std::uint32_t height;
+  std::uint32_t max_depth;
+  std::uint32_t seed;
+  float camera_position[3];
+  float focal_length;
+  float viewport_height;
+  // Keeps scene_identity aligned without padding, which memcmp() would
+  // compare
+  std::uint32_t reserved;
+  std::uint64_t scene_identity;
+};
+static_assert(sizeof(CheckpointHeader) == 56U);
+
+CheckpointHeader MakeCheckpointHeader(
+    const RenderSettings& settings,
+    std::uint64_t scene_identity) {
+  return CheckpointHeader{
+    kCheckpointMagic,
+    kCheckpointVersion,
+    static_cast<std::uint32_t>(settings.image_width),
+    static_cast<std::uint32_t>(settings.image_height),
+    static_cast<std::uint32_t>(settings.max_depth),
+    settings.seed,
+    { settings.camera_position.x,
+      settings.camera_position.y,
+      settings.camera_position.z },
+    settings.focal_length,
+    settings.viewport_height,
+    0U,
+    scene_identity
+  };
+}
+
+// Index of cell (x, y) along the order's curve through a size by size
+// grid, where size is a power of two
+std::uint32_t EncodeCurve(
+    PixelOrder order,
+    std::uint32_t size,
+    std::uint32_t x,
+    std::uint32_t y) {
+  return order == PixelOrder::kMorton ? MortonEncode2D(x, y)
+                                      : HilbertEncode2D(size, x, y);
+}
+
+glm::vec3 ComputeBackgroundColor(const glm::vec3& direction) {
+  // White-to-blue gradient used when the scene has no environment map
+  const float a{
+    0.5F * (direction.y + 1.0F)
+  };
+
+  return (1.0F - a) * glm::vec3{ 1.0F, 1.0F, 1.0F }
+         + a * glm::vec3{ 0.5F, 0.7F, 1.0F };
+}
+
+// Flushes a written file to the disk, so a rename that follows cannot
+// land before the data does
+bool SyncFile(const std::filesystem::path& path) {
+#if defined(_WIN32)
+  const HANDLE handle{
+    CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)
+  };
+  if (handle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  const bool synced{ FlushFileBuffers(handle) != 0 };
+  CloseHandle(handle);
+  return synced;
+#else
+  const int handle{ open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+  if (handle < 0) {
+    return false;
+  }
+  const bool synced{ fsync(handle) == 0 };
+  close(handle);
+  return synced;
+#endif
+}
+
+// Flushes a directory's entries to the disk, so a rename into it survives
+// a crash. Windows has no equivalent for directories.
+bool SyncDirectory(const std::filesystem::path& path) {
+#if defined(_WIN32)
+  static_cast<void>(path);
+  return true;
+#else
+  const int handle{
+    open(path.empty() ? "." : path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)
+  };
+  if (handle < 0) {
+    return false;
+  }
+  const bool synced{ fsync(handle) == 0 };
+  close(handle);
+  return synced;
+#endif
+}
+
+}  // namespace
+
+Renderer::Renderer(const RenderSettings& settings)
+    : settings_{ settings }
+    , primary_ray_params_{ ComputePrimaryRayParams() }
+    , accumulation_(3U * settings.image_width * settings.image_height, 0.0F)
+    , sample_counts_(settings.image_width * settings.image_height, 0U) {}
+
+void Renderer::Render(
+    const Scene& scene,
+    const CheckpointSettings& checkpoint) {
+  const KernelTable& kernels{ GetKernels() };
+  const std::size_t image_width{ settings_.image_width };
+  const glm::vec3 camera_position{ settings_.camera_position };
+  const std::uint32_t samples_per_pixel{
+    static_cast<std::uint32_t>(settings_.samples_per_pixel)
+  };
+
+  // Count the samples still missing, e.g. after resuming
+  std::size_t remaining_sample_count{ 0U };
+  for (const std::uint32_t sample_count : sample_counts_) {
+    remaining_sample_count += samples_per_pixel - std::min(sample_count, samples_per_pixel);
+  }
+  if (remaining_sample_count == 0U) {
+    spdlog::info("Image already has {} samples per pixel.", samples_per_pixel);
+    return;
+  }
+
+  spdlog::info("Tracing pixels in {} order{}.", ToString(settings_.pixel_order),
+               settings_.bin_secondary_rays ? " with binned secondary rays" : "");
+  const std::vector<std::uint32_t> pixel_order{ ComputePixelOrder() };
+  const float pixel_spread_angle{ ComputePixelSpreadAngle() };
+
+  // Scratch buffers holding one batch worth of paths
+  std::vector<PathState> paths{};
+  paths.reserve(kPathBatchSize);
+  std::vector<float> jitter_u(kPathBatchSize);
+  std::vector<float> jitter_v(kPathBatchSize);
+  std::vector<float> direction_x(kPathBatchSize);
+  std::vector<float> direction_y(kPathBatchSize);
+  std::vector<float> direction_z(kPathBatchSize);
+
+  // Begin timer
+  const std::chrono::time_point start_time{ std::chrono::high_resolution_clock::now() };
+  std::chrono::time_point checkpoint_time{ start_time };
+  std::size_t rendered_sample_count{ 0U };
+  std::size_t ray_count{ 0U };
+
+  // Render one pass over the image per sample index, so a checkpoint
+  // taken between batches leaves every pixel at most one sample apart
+  const std::uint32_t first_pass{
+    *std::min_element(sample_counts_.begin(), sample_counts_.end())
+  };
+  for (std::uint32_t pass{ first_pass }; pass < samples_per_pixel; ++pass) {
+    for (std::size_t batch_start{ 0U }; batch_start < pixel_order.size();
+         batch_start += kPathBatchSize) {
+      const std::size_t batch_end{
+        std::min(batch_start + kPathBatchSize, pixel_order.size())
+      };
+
+      // Start a path for every pixel of the batch still missing this
+      // pass's sample, drawing a random offset within the pixel from the
+      // sampler that then continues along the path
+      paths.clear();
+      for (std::size_t i{ batch_start }; i < batch_end; ++i) {
+        const std::uint32_t pixel{ pixel_order[i] };
+        if (sample_counts_[pixel] != pass) {
+          continue;
+        }
+
+        // The camera ray is filled in once the batch's jitter is drawn
+        PathState& path{
+          paths.emplace_back(PathState{
+            Ray{ camera_position, glm::vec3{ 0.0F, 0.0F, -1.0F } },
+            glm::vec3{ 0.0F, 0.0F, 0.0F },
+            glm::vec3{ 1.0F, 1.0F, 1.0F },
+            glm::vec3{},
+            glm::vec3{},
+            0.0F,
+            0.0F,
+            pixel_spread_angle,
+            pixel,
+            0U,
+            PixelSampler{ settings_.seed, pixel, pass }
+          })
+        };
+        jitter_u[paths.size() - 1U] = path.sampler.Next();
+        jitter_v[paths.size() - 1U] = path.sampler.Next();
+      }
+
+      // Generate the primary rays with one kernel call per run of
+      // horizontally adjacent pixels, i.e. whole rows in raster order
+      for (std::size_t run_start{ 0U }; run_start < paths.size();) {
+        const std::uint32_t first_pixel{ paths[run_start].pixel };
+        const std::size_t first_u{ first_pixel % image_width };
+        std::size_t run_end{ run_start + 1U };
+        while (run_end < paths.size()
+               && first_u + (run_end - run_start) < image_width
+               && paths[run_end].pixel == first_pixel + (run_end - run_start)) {
+          ++run_end;
+        }
+
+        kernels.generate_primary_rays(primary_ray_params_, first_pixel / image_width,
+                                      first_u, run_end - run_start,
+                                      jitter_u.data() + run_start,
+                                      jitter_v.data() + run_start,
+                                      direction_x.data() + run_start,
+                                      direction_y.data() + run_start,
+                                      direction_z.data() + run_start);
+        run_start = run_end;
+      }
+      for (std::size_t i{ 0U }; i < paths.size(); ++i) {
+        paths[i].ray = Ray{
+          camera_position,
+          glm::vec3{ direction_x[i], direction_y[i], direction_z[i] }
+        };
+      }
+
+      // Trace the batch and accumulate each path's color into its pixel
+      TracePaths(scene, paths);
+      for (const PathState& path : paths) {
+        float* pixel_accumulation{ accumulation_.data() + 3U * path.pixel };
+        pixel_accumulation[0U] += path.color.r;
+        pixel_accumulation[1U] += path.color.g;
+        pixel_accumulation[2U] += path.color.b;
+        ++sample_counts_[path.pixel];
+        ray_count += path.ray_count;
+      }
+      rendered_sample_count += paths.size();
+
+      // Log progress every tenth of the remaining samples
+      const std::size_t previous_sample_count{ rendered_sample_count - paths.size() };
+      if ((10U * previous_sample_count) / remaining_sample_count
+          != (10U * rendered_sample_count) / remaining_sample_count) {
+        spdlog::info("Rendered {}% of samples.",
+                     (100U * rendered_sample_count) / remaining_sample_count);
+      }
+
+      // Checkpoint periodically between batches
+      const std::chrono::time_point now{ std::chrono::high_resolution_clock::now() };
+      if (!checkpoint.path.empty() && now - checkpoint_time >= checkpoint.interval) {
+        SaveCheckpoint(checkpoint);
+        checkpoint_time = now;
+      }
+    }
+  }
+
+  // Stop timer
+  const std::chrono::time_point end_time{ std::chrono::high_resolution_clock::now() };
+
+  // Compute and log elapsed time and ray throughput, counting shadow rays
+  const std::chrono::duration<float> elapsed_time{ end_time - start_time };
+  spdlog::info("Image rendered in {} seconds ({:.2f} Mrays/s).", elapsed_time.count(),
+               static_cast<float>(ray_count) / elapsed_time.count() * 1.0e-6F);
+
+  // Keep the finished samples so more can be added later
+  if (!checkpoint.path.empty()) {
+    SaveCheckpoint(checkpoint);
+  }
+}
+
+std::vector<std::uint8_t> Renderer::ResolveImage() const {
+  const KernelTable& kernels{ GetKernels() };
+  std::vector<std::uint8_t> pixels(accumulation_.size());
+  for (std::size_t i{ 0U }; i < sample_counts_.size(); ++i) {
+    const float weight_per_sample{
+      1.0F / static_cast<float>(std::max(sample_counts_[i], 1U))
+    };
+    kernels.tonemap(accumulation_.data() + 3U * i, 3U,
+                    weight_per_sample, pixels.data() + 3U * i);
+  }
+
+  return pixels;
+}
+
+bool Renderer::WriteImage(const std::filesystem::path& path) const {
+  // Open output image file
+  std::ofstream output_image_file{ path };
+  if (!output_image_file) {
+    spdlog::error("Failed to open output image file {}.", path.string());
+    return false;
+  }
+
+  // Tonemap the averaged accumulation buffer to 8-bit
+  const std::vector<std::uint8_t> pixels{ ResolveImage() };
+
+  // Write header and pixels to output image file
+  output_image_file << "P3\n"
+                    << settings_.image_width << ' ' << settings_.image_height
+                    << "\n255\n";
+  for (std::size_t i{ 0U }; i < pixels.size(); i += 3U) {
+    output_image_file << static_cast<int>(pixels[i + 0U]) << ' '
+                      << static_cast<int>(pixels[i + 1U]) << ' '
+                      << static_cast<int>(pixels[i + 2U]) << '\n';
+  }
+
+  return static_cast<bool>(output_image_file);
+}
+
+bool Renderer::SaveCheckpoint(const CheckpointSettings& checkpoint) const {
+  const std::filesystem::path& path{ checkpoint.path };
+  std::filesystem::path temporary_path{ path };
+  temporary_path += ".tmp";
+
+  // Write the complete checkpoint next to the previous one
+  {
+    std::ofstream output_file{ temporary_path, std::ios::binary };
+    if (!output_file) {
+      spdlog::error("Failed to open checkpoint {} for writing.", temporary_path.string());
+      return false;
+    }
+
+    const CheckpointHeader header{
+      MakeCheckpointHeader(settings_, checkpoint.scene_identity)
+    };
+    output_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output_file.write(reinterpret_cast<const char*>(sample_counts_.data()),
+                      static_cast<std::streamsize>(sample_counts_.size()
+                                                   * sizeof(std::uint32_t)));
+    output_file.write(reinterpret_cast<const char*>(accumulation_.data()),
+                      static_cast<std::streamsize>(accumulation_.size() * sizeof(float)));
+    output_file.close();
+    if (!output_file || !SyncFile(temporary_path)) {
+      spdlog::error("Failed to write checkpoint {}.", temporary_path.string());
+      return false;
+    }
+  }
+
+  // Replace the previous checkpoint in a single step, then make the new
+  // name durable too
+  std::error_code error{};
+  std::filesystem::rename(temporary_path, path, error);
+  if (error) {
+    spdlog::error("Failed to replace checkpoint {}: {}.", path.string(), error.message());
+    return false;
+  }
+  if (!SyncDirectory(path.parent_path())) {
+    spdlog::warn("Failed to flush the directory of checkpoint {}.", path.string());
+  }
+
+  spdlog::info("Saved checkpoint {}.", path.string());
+  return true;
+}
+
+bool Renderer::LoadCheckpoint(const CheckpointSettings& checkpoint) {
+  const std::filesystem::path& path{ checkpoint.path };
+  std::ifstream input_file{ path, std::ios::binary };
+  if (!input_file) {
+    spdlog::error("Failed to open checkpoint {}.", path.string());
+    return false;
+  }
+
+  CheckpointHeader header{};
+  input_file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!input_file
+      || header.magic != kCheckpointMagic
+      || header.version != kCheckpointVersion) {
+    spdlog::error("{} is not a valid checkpoint.", path.string());
+    return false;
+  }
+
+  // Samples can only be continued with the scene and settings they were
+  // taken with
+  if (header.scene_identity != checkpoint.scene_identity) {
+    spdlog::error("Checkpoint {} was rendered from a different scene.", path.string());
+    return false;
+  }
+  const CheckpointHeader expected_header{
+    MakeCheckpointHeader(settings_, checkpoint.scene_identity)
+  };
+  if (std::memcmp(&header, &expected_header, sizeof(header)) != 0) {
+    spdlog::error("Checkpoint {} was rendered with different settings.", path.string());
+    return false;
+  }
+
+  std::vector<std::uint32_t> sample_counts(sample_counts_.size());
+  std::vector<float> accumulation(accumulation_.size());
+  input_file.read(reinterpret_cast<char*>(sample_counts.data()),
+                  static_cast<std::streamsize>(sample_counts.size() * sizeof(std::uint32_t)));
+  input_file.read(reinterpret_cast<char*>(accumulation.data()),
+                  static_cast<std::streamsize>(accumulation.size() * sizeof(float)));
+  if (!input_file) {
+    spdlog::error("Checkpoint {} is truncated.", path.string());
+    return false;
+  }
+
+  sample_counts_ = std::move(sample_counts);
+  accumulation_ = std::move(accumulation);
+
+  spdlog::info("Resumed from checkpoint {} with {} to {} samples per pixel.",
+               path.string(),
+               *std::min_element(sample_counts_.begin(), sample_counts_.end()),
+               *std::max_element(sample_counts_.begin(), sample_counts_.end()));
+  return true;
+}
+
+void Renderer::Reset(const RenderSettings& settings) {
+  settings_ = settings;
+  primary_ray_params_ = ComputePrimaryRayParams();
+  accumulation_.assign(3U * settings_.image_width * settings_.image_height, 0.0F);
+  sample_counts_.assign(settings_.image_width * settings_.image_height, 0U);
+}
+
+void Renderer::ClearPixels(
+    std::size_t min_u,
+    std::size_t min_v,
+    std::size_t max_u,
+    std::size_t max_v) {
+  for (std::size_t v{ min_v }; v < max_v; ++v) {
+    const std::size_t row{ settings_.image_width * v };
+    std::fill(sample_counts_.begin() + static_cast<std::ptrdiff_t>(row + min_u),
+              sample_counts_.begin() + static_cast<std::ptrdiff_t>(row + max_u), 0U);
+    std::fill(accumulation_.begin() + static_cast<std::ptrdiff_t>(3U * (row + min_u)),
+              accumulation_.begin() + static_cast<std::ptrdiff_t>(3U * (row + max_u)), 0.0F);
+  }
+}
+
+void Renderer::AccumulateSample(
+    const Scene& scene,
+    std::size_t u,
+    std::size_t v) {
+  const std::size_t pixel{ settings_.image_width * v + u };
+  PixelSampler sampler{ settings_.seed, pixel, sample_counts_[pixel] };
+  const float jitter_u{ sampler.Next() };
+  const float jitter_v{ sampler.Next() };
+
+  float direction[3]{};
+  GetKernels().generate_primary_rays(primary_ray_params_, v, u, 1U,
+                                     &jitter_u, &jitter_v,
+                                     &direction[0], &direction[1], &direction[2]);
+
+  PathState path{
+    Ray{ settings_.camera_position, glm::vec3{ direction[0], direction[1], direction[2] } },
+    glm::vec3{ 0.0F, 0.0F, 0.0F },
+    glm::vec3{ 1.0F, 1.0F, 1.0F },
+    glm::vec3{},
+    glm::vec3{},
+    0.0F,
+    0.0F,
+    ComputePixelSpreadAngle(),
+    static_cast<std::uint32_t>(pixel),
+    0U,
+    sampler
+  };
+  for (std::size_t depth{ 0U }; depth < settings_.max_depth; ++depth) {
+    if (!ExtendPath(scene, path)) {
+      break;
+    }
+  }
+
+  float* pixel_accumulation{ accumulation_.data() + 3U * pixel };
+  pixel_accumulation[0U] += path.color.r;
+  pixel_accumulation[1U] += path.color.g;
+  pixel_accumulation[2U] += path.color.b;
+  ++sample_counts_[pixel];
+}
+
+PrimaryRayParams Renderer::ComputePrimaryRayParams() const noexcept {
+  const float image_width{ static_cast<float>(settings_.image_width) };
+  const float image_height{ static_cast<float>(settings_.image_height) };
+
+  const float viewport_height{ settings_.viewport_height };
+  const float viewport_width{ viewport_height * (image_width / image_height) };
+
+  const glm::vec3 viewport_v{ 0.0F, -viewport_height, 0.0F };
+  const glm::vec3 viewport_u{ viewport_width, 0.0F, 0.0F };
+
+  const glm::vec3 delta_v{ viewport_v / image_height };
+  const glm::vec3 delta_u{ viewport_u / image_width };
+
+  const glm::vec3 viewport_upper_left_position{
+    settings_.camera_position
+    - glm::vec3{ 0.0F, 0.0F, settings_.focal_length }
+    - 0.5F * (viewport_u + viewport_v)
+  };
+
+  const glm::vec3 upper_left_pixel_position{
+    viewport_upper_left_position
+    + 0.5F * (delta_u + delta_v)
+  };
+
+  return PrimaryRayParams{
+    { settings_.camera_position.x,
+      settings_.camera_position.y,
+      settings_.camera_position.z },
+    { upper_left_pixel_position.x,
+      upper_left_pixel_position.y,
+      upper_left_pixel_position.z },
+    { delta_u.x, delta_u.y, delta_u.z },
+    { delta_v.x, delta_v.y, delta_v.z }
+  };
+}
+
+float Renderer::ComputePixelSpreadAngle() const noexcept {
+  // Pixel height on the viewport over its distance, exact at the center
+  return settings_.viewport_height
+         / (settings_.focal_length * static_cast<float>(settings_.image_height));
+}
+
+std::vector<std::uint32_t> Renderer::ComputePixelOrder() const {
+  const std::uint32_t image_width{ static_cast<std::uint32_t>(settings_.image_width) };
+  const std::uint32_t image_height{ static_cast<std::uint32_t>(settings_.image_height) };
+
+  std::vector<std::uint32_t> order(sample_counts_.size());
+  std::iota(order.begin(), order.end(), 0U);
+  if (settings_.pixel_order == PixelOrder::kRaster) {
+    return order;
+  }
+
+  // Visit tiles along the curve and the pixels of each tile along the same
+  // curve again, by sorting on the tile's curve index, then the pixel's
+  // index within its tile, then the pixel itself
+  const std::uint32_t tile_column_count{ (image_width + kTileSize - 1U) / kTileSize };
+  const std::uint32_t tile_row_count{ (image_height + kTileSize - 1U) / kTileSize };
+  std::uint32_t tile_grid_size{ 1U };
+  while (tile_grid_size < std::max(tile_column_count, tile_row_count)) {
+    tile_grid_size *= 2U;
+  }
+
+  std::vector<std::uint64_t> keys(order.size());
+  for (std::uint32_t v{ 0U }; v < image_height; ++v) {
+    for (std::uint32_t u{ 0U }; u < image_width; ++u) {
+      const std::uint32_t pixel{ image_width * v + u };
+      const std::uint64_t tile_index{
+        EncodeCurve(settings_.pixel_order, tile_grid_size, u / kTileSize, v / kTileSize)
+      };
+      const std::uint64_t pixel_index{
+        EncodeCurve(settings_.pixel_order, kTileSize, u % kTileSize, v % kTileSize)
+      };
+      keys[pixel] = ((tile_index << 8U | pixel_index) << 32U) | pixel;
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+
+  for (std::size_t i{ 0U }; i < keys.size(); ++i) {
+    order[i] = static_cast<std::uint32_t>(keys[i]);
+  }
+
+  return order;
+}
+
+void Renderer::TracePaths(const Scene& scene, std::vector<PathState>& paths) const {
+  // Indices of the paths still bouncing
+  std::vector<std::uint32_t> active(paths.size());
+  std::iota(active.begin(), active.end(), 0U);
+  std::vector<std::uint64_t> keys{};
+
+  for (std::size_t depth{ 0U }; depth < settings_.max_depth && !active.empty(); ++depth) {
+    // Group secondary rays that start close together and head the same
+    // way, so consecutive traversals touch the same nodes and spheres.
+    // Paths are independent, so this changes only the speed, never the
+    // image.
+    if (settings_.bin_secondary_rays && depth > 0U && active.size() > 1U) {
+      glm::vec3 bounds_min{ std::numeric_limits<float>::infinity() };
+      glm::vec3 bounds_max{ -std::numeric_limits<float>::infinity() };
+      for (const std::uint32_t index : active) {
+        bounds_min = glm::min(bounds_min, paths[index].ray.origin());
+        bounds_max = glm::max(bounds_max, paths[index].ray.origin());
+      }
+
+      // Key on direction octant, then origin cell along a Z-order curve
+      // through the bounds of the batch's origins
+      const float cell_count{ static_cast<float>(1U << kBinGridBits) };
+      const glm::vec3 cell_scale{
+        (cell_count - 1.0F) / glm::max(bounds_max - bounds_min, glm::vec3{ 1.0e-6F })
+      };
+      keys.clear();
+      for (const std::uint32_t index : active) {
+        const Ray& ray{ paths[index].ray };
+        const glm::vec3 cell{ (ray.origin() - bounds_min) * cell_scale };
+        const std::uint32_t octant{
+          (ray.direction().x < 0.0F ? 1U : 0U)
+          | (ray.direction().y < 0.0F ? 2U : 0U)
+          | (ray.direction().z < 0.0F ? 4U : 0U)
+        };
+        const std::uint64_t bin{
+          octant << (3U * kBinGridBits)
+          | MortonEncode3D(static_cast<std::uint32_t>(cell.x),
+                           static_cast<std::uint32_t>(cell.y),
+                           static_cast<std::uint32_t>(cell.z))
+        };
+        keys.emplace_back((bin << 32U) | index);
+      }
+      std::sort(keys.begin(), keys.end());
+
+      for (std::size_t i{ 0U }; i < keys.size(); ++i) {
+        active[i] = static_cast<std::uint32_t>(keys[i]);
+      }
+    }
+
+    // Extend every active path by one bounce, dropping those that ended
+    std::size_t active_count{ 0U };
+    for (const std::uint32_t index : active) {
+      if (ExtendPath(scene, paths[index])) {
+        active[active_count++] = index;
+      }
+    }
+    active.resize(active_count);
+  }
+}
+
+bool Renderer::ExtendPath(const Scene& scene, PathState& path) const {
+  const EnvironmentMap* environment{ scene.environment().get() };
+  const LightTree& light_tree{ scene.light_tree() };
+  PixelSampler& sampler{ path.sampler };
+
+  // Trace ray against all traceable objects in the scene
+  const std::optional<TraceResult> trace_result{
+    scene.TraceRay(path.ray, kRayEpsilon, std::numeric_limits<float>::infinity())
+  };
+  ++path.ray_count;
+
+  // Ray escaped, add background radiance weighted against the
+  // chance of light sampling having produced the same direction
+  if (!trace_result.has_value()) {
+    if (!environment) {
+      path.color += path.throughput * ComputeBackgroundColor(path.ray.direction());
+    } else {
+      const float weight{
+        path.scatter_pdf > 0.0F
+          ? PowerHeuristic(path.scatter_pdf, environment->Pdf(path.ray.direction()))
+          : 1.0F
+      };
+      path.color += path.throughput * environment->Evaluate(path.ray.direction()) * weight;
+    }
+    return false;
+  }
+
+  const glm::vec3& position{ trace_result.value().impact_position };
+  const glm::vec3& normal{ trace_result.value().impact_normal };
+  const Material& material{ trace_result.value().material };
+
+  // Add light emitted towards the ray, weighted against the chance of
+  // the light tree having sampled the same emitter
+  const glm::vec3& emission{ material.emission };
+  if (trace_result.value().is_front_face
+      && (emission.r > 0.0F || emission.g > 0.0F || emission.b > 0.0F)) {
+    const float weight{
+      path.scatter_pdf > 0.0F
+        ? PowerHeuristic(path.scatter_pdf,
+                         light_tree.Pdf(path.previous_position, path.previous_normal,
+                                        trace_result.value().primitive_index))
+        : 1.0F
+    };
+    path.color += path.throughput * emission * weight;
+  }
+
+  // Modulate the albedo by the material's texture, filtered over the ray
+  // cone's footprint at the impact
+  const TextureCache* texture_cache{ scene.texture_cache().get() };
+  const float cone_width{
+    path.cone_width + path.cone_spread * trace_result.value().distance
+  };
+  glm::vec3 albedo{ material.albedo };
+  if (material.albedo_texture != kNoTexture && texture_cache) {
+    const glm::vec2& texture_coordinates{ trace_result.value().texture_coordinates };
+    albedo *= texture_cache->Sample(material.albedo_texture,
+                                    texture_coordinates.x, texture_coordinates.y,
+                                    cone_width * trace_result.value().texture_scale);
+  }
+
+  const glm::vec3 diffuse_brdf{ albedo / kPi };
+
+  // Draw this bounce's random numbers up front, in a fixed order that
+  // does not depend on argument evaluation order or on which lights exist
+  const float light_u[3]{ sampler.Next(), sampler.Next(), sampler.Next() };
+  const float environment_u[3]{ sampler.Next(), sampler.Next(), sampler.Next() };
+  const float scatter_u[2]{ sampler.Next(), sampler.Next() };
+
+  // Sample one emitter picked by the light tree
+  if (!light_tree.empty()) {
+    const std::optional<LightSample> light_sample{
+      light_tree.Sample(position, normal, light_u[0], light_u[1], light_u[2])
+    };
+    if (light_sample.has_value()) {
+      const float cos_theta{ glm::dot(normal, light_sample.value().direction) };
+      if (light_sample.value().pdf > 0.0F && cos_theta > 0.0F) {
+        const Ray shadow_ray{ position, light_sample.value().direction };
+        const bool occluded{
+          scene.TraceRay(shadow_ray, kRayEpsilon,
+                         light_sample.value().distance - kRayEpsilon).has_value()
+        };
+        ++path.ray_count;
+        if (!occluded) {
+          const float weight{
+            PowerHeuristic(light_sample.value().pdf, cos_theta / kPi)
+          };
+          path.color += path.throughput * diffuse_brdf * light_sample.value().radiance
+                        * (cos_theta * weight / light_sample.value().pdf);
+        }
+      }
+    }
+  }
+
+  // Sample the environment directly, in proportion to its luminance
+  if (environment) {
+    const EnvironmentSample light_sample{
+      environment->Sample(environment_u[0], environment_u[1], environment_u[2])
+    };
+    const float cos_theta{ glm::dot(normal, light_sample.direction) };
+    if (light_sample.pdf > 0.0F && cos_theta > 0.0F) {
+      const Ray shadow_ray{ position, light_sample.direction };
+      const bool occluded{
+        scene.TraceRay(shadow_ray, kRayEpsilon,
+                       std::numeric_limits<float>::infinity()).has_value()
+      };
+      ++path.ray_count;
+      if (!occluded) {
+        const float weight{ PowerHeuristic(light_sample.pdf, cos_theta / kPi) };
+        path.color += path.throughput * diffuse_brdf * light_sample.radiance
+                      * (cos_theta * weight / light_sample.pdf);
+      }
+    }
+  }
+
+  // Continue the path in a cosine-weighted direction; the cosine and
+  // pdf cancel, leaving only the albedo
+  const glm::vec3 scatter_direction{
+    SampleCosineHemisphere(normal, scatter_u[0], scatter_u[1])
+  };
+  path.scatter_pdf = glm::dot(normal, scatter_direction) / kPi;
+  path.throughput *= albedo;
+  path.cone_width = cone_width;
+  path.cone_spread = std::max(path.cone_spread, kDiffuseConeSpread);
+  path.previous_position = position;
+  path.previous_normal = normal;
+  path.ray = Ray{ position, scatter_direction };
+
+  return true;
+}
+
+std::optional<PixelOrder> ParsePixelOrder(std::string_view name) noexcept {
+  if (name == "raster") { return PixelOrder::kRaster; }
+  if (name == "morton") { return PixelOrder::kMorton; }
+  if (name == "hilbert") { return PixelOrder::kHilbert; }
+  return std::nullopt;
+}
+
+std::string_view ToString(PixelOrder order) noexcept {
+  switch (order) {
+    case PixelOrder::kRaster: { return "raster"; }
+    case PixelOrder::kMorton: { return "morton"; }
+    case PixelOrder::kHilbert: { return "hilbert"; }
+    default: { return "unknown"; }
+  }
+}
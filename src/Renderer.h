@@ -0,0 +1,184 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+// STL
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// glm
+#include "glm/vec3.hpp"
+
+// src
+#include "Kernels.h"
+#include "Ray.h"
+#include "Sampling.h"
+
+// Forward declarations
+class Scene;
+
+// Order pixels are traced in. The curves visit the image tile by tile and
+// each tile pixel by pixel, keeping consecutive rays close together.
+enum class PixelOrder {
+  kRaster,
+  kMorton,
+  kHilbert
+};
+
+struct RenderSettings {
+  // Ray tracing settings
+  std::size_t samples_per_pixel{ 100U };
+  std::size_t max_depth{ 10U };
+  // Renders with equal settings and seed produce identical images
+  std::uint32_t seed{ 0U };
+
+  // Camera settings
+  glm::vec3 camera_position{ 0.0F, 0.0F, 0.0F };
+  float focal_length{ 1.0F };
+
+  // Image settings
+  std::size_t image_width{ 1280U };
+  std::size_t image_height{ 720U };
+  float viewport_height{ 2.0F };
+
+  // Traversal settings, which change speed but never the image
+  PixelOrder pixel_order{ PixelOrder::kHilbert };
+  // Sort secondary rays by origin and direction between bounces
+  bool bin_secondary_rays{ true };
+
+  bool operator==(const RenderSettings&) const = default;
+};
+
+struct CheckpointSettings {
+  // Checkpoints are disabled if empty
+  std::filesystem::path path{};
+  std::chrono::seconds interval{ 60 };
+  // Identifies the scene rendered (e.g. by HashSceneFile()), so samples of
+  // one scene are never resumed into a render of another
+  std::uint64_t scene_identity{ 0U };
+};
+
+class Renderer {
+public:
+  Renderer() = delete;
+  explicit Renderer(const RenderSettings& settings);
+
+  // Renders one sample for every pixel per pass until each pixel has
+  // samples_per_pixel, continuing from samples already accumulated (e.g.
+  // by LoadCheckpoint()); checkpoints between batches once the interval
+  // has passed, and once finished.
+  // Pixels are traced in batches following settings.pixel_order.
+  void Render(
+    const Scene& scene,
+    const CheckpointSettings& checkpoint = CheckpointSettings{});
+
+  // Tonemaps the averaged accumulation buffer to 8-bit RGB, row-major
+  [[nodiscard]]
+  std::vector<std::uint8_t> ResolveImage() const;
+
+  // Writes the resolved image as a PPM image
+  bool WriteImage(const std::filesystem::path& path) const;
+
+  // Writes accumulated samples to a temporary file, then renames it over
+  // checkpoint.path so an interrupted write never corrupts the previous
+  // checkpoint
+  bool SaveCheckpoint(const CheckpointSettings& checkpoint) const;
+
+  // Restores accumulated samples saved from the same scene with the same
+  // image, camera, depth and seed; samples_per_pixel may differ to render
+  // more samples
+  bool LoadCheckpoint(const CheckpointSettings& checkpoint);
+
+  // Replaces the settings and clears the accumulation buffer
+  void Reset(const RenderSettings& settings);
+
+  // Discards the samples of the pixels in [min_u, max_u) x [min_v, max_v)
+  void ClearPixels(
+    std::size_t min_u,
+    std::size_t min_v,
+    std::size_t max_u,
+    std::size_t max_v);
+
+  // Traces the next sample through pixel (u, v) and adds it to the
+  // accumulation buffer; safe to call concurrently for distinct pixels
+  void AccumulateSample(
+    const Scene& scene,
+    std::size_t u,
+    std::size_t v);
+
+  [[nodiscard]]
+  constexpr const RenderSettings& settings() const noexcept {
+    return settings_;
+  }
+
+  [[nodiscard]]
+  constexpr const std::vector<float>& accumulation() const noexcept {
+    return accumulation_;
+  }
+
+  [[nodiscard]]
+  constexpr const std::vector<std::uint32_t>& sample_counts() const noexcept {
+    return sample_counts_;
+  }
+
+private:
+  // One sample's path, carried from bounce to bounce
+  struct PathState {
+    Ray ray;
+    glm::vec3 color;
+    glm::vec3 throughput;
+    // Surface the current ray left from, needed to evaluate light pdfs
+    glm::vec3 previous_position;
+    glm::vec3 previous_normal;
+    // Density the current ray direction was sampled with; zero for the
+    // camera ray, which cannot be produced by light sampling
+    float scatter_pdf;
+    // Cone of rays the path stands for, sizing texture footprints: its
+    // width at the ray origin and its spread angle in radians
+    float cone_width;
+    float cone_spread;
+    std::uint32_t pixel;
+    std::uint32_t ray_count;
+    PixelSampler sampler;
+  };
+
+  [[nodiscard]]
+  PrimaryRayParams ComputePrimaryRayParams() const noexcept;
+
+  // Angle a single pixel subtends from the camera
+  [[nodiscard]]
+  float ComputePixelSpreadAngle() const noexcept;
+
+  // Pixel indices in the order set by settings
+  [[nodiscard]]
+  std::vector<std::uint32_t> ComputePixelOrder() const;
+
+  // Extends a batch of paths bounce by bounce until all have terminated
+  void TracePaths(const Scene& scene, std::vector<PathState>& paths) const;
+
+  // Traces the path's current ray, adds the light it gathers and picks
+  // the next ray; returns false if the path has terminated
+  bool ExtendPath(const Scene& scene, PathState& path) const;
+
+private:
+  RenderSettings settings_;
+  PrimaryRayParams primary_ray_params_;
+
+  // Sum of linear RGB samples per pixel, row-major
+  std::vector<float> accumulation_;
+  // Samples accumulated per pixel, which is also the index of the next
+  // sample and so selects its random numbers
+  std::vector<std::uint32_t> sample_counts_;
+};
+
+[[nodiscard]]
+std::optional<PixelOrder> ParsePixelOrder(std::string_view name) noexcept;
+
+[[nodiscard]]
+std::string_view ToString(PixelOrder order) noexcept;
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+// STL
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+// glm
+#include "glm/vec3.hpp"
+
+inline constexpr float kPi{ std::numbers::pi_v<float> };
+
+[[nodiscard]]
+inline float Luminance(const glm::vec3& color) noexcept {
+  return 0.2126F * color.r + 0.7152F * color.g + 0.0722F * color.b;
+}
+
+// Multiple importance sampling weight for a sample drawn with pdf
+// when the other strategy would have drawn it with other_pdf
+[[nodiscard]]
+inline float PowerHeuristic(float pdf, float other_pdf) noexcept {
+  const float pdf_squared{ pdf * pdf };
+  return pdf_squared / (pdf_squared + other_pdf * other_pdf);
+}
+
+// Builds an orthonormal basis around a unit vector (Duff et al. 2017)
+inline void BuildOrthonormalBasis(
+    const glm::vec3& normal,
+    glm::vec3& tangent,
+    glm::vec3& bitangent) noexcept {
+  const float sign{ std::copysign(1.0F, normal.z) };
+  const float a{ -1.0F / (sign + normal.z) };
+  const float b{ normal.x * normal.y * a };
+  tangent = glm::vec3{
+    1.0F + sign * normal.x * normal.x * a, sign * b, -sign * normal.x
+  };
+  bitangent = glm::vec3{ b, sign + normal.y * normal.y * a, -normal.y };
+}
+
+// Maps two uniform numbers to a direction around normal with density
+// cos(theta) / pi
+[[nodiscard]]
+inline glm::vec3 SampleCosineHemisphere(
+    const glm::vec3& normal,
+    float u0,
+    float u1) noexcept {
+  glm::vec3 tangent{};
+  glm::vec3 bitangent{};
+  BuildOrthonormalBasis(normal, tangent, bitangent);
+
+  // Project a uniform disk sample up onto the hemisphere
+  const float radius{ std::sqrt(u0) };
+  const float phi{ 2.0F * kPi * u1 };
+  const float x{ radius * std::cos(phi) };
+  const float y{ radius * std::sin(phi) };
+  const float z{ std::sqrt(std::max(0.0F, 1.0F - u0)) };
+
+  return x * tangent + y * bitangent + z * normal;
+}
+
+// Random number stream of a single sample of a single pixel (PCG-XSH-RR).
+//
+// Seeding from the pixel and sample index rather than carrying one
+// generator through the whole render makes every sample independent of
+// the order samples are taken in, so interrupted and resumed or extended
+// renders reproduce an uninterrupted one exactly.
+class PixelSampler {
+public:
+  PixelSampler(std::uint32_t seed, std::uint64_t pixel, std::uint32_t sample) noexcept
+      : state_{ 0U }
+      , increment_{ (pixel << 1U) | 1U } {
+    // Pick the pixel's stream through the increment and scramble the
+    // seed and sample index into the starting state
+    std::uint64_t mixed{
+      (static_cast<std::uint64_t>(seed) << 32U | sample) + 0x9E3779B97F4A7C15ULL
+    };
+    mixed = (mixed ^ (mixed >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+    mixed = (mixed ^ (mixed >> 27U)) * 0x94D049BB133111EBULL;
+    mixed ^= mixed >> 31U;
+
+    Advance();
+    state_ += mixed;
+    Advance();
+  }
+
+  [[nodiscard]]
+  std::uint32_t NextUint() noexcept {
+    const std::uint64_t old_state{ state_ };
+    Advance();
+    const std::uint32_t xor_shifted{
+      static_cast<std::uint32_t>(((old_state >> 18U) ^ old_state) >> 27U)
+    };
+    return std::rotr(xor_shifted, static_cast<int>(old_state >> 59U));
+  }
+
+  // Uniform in [0, 1)
+  [[nodiscard]]
+  float Next() noexcept {
+    return static_cast<float>(NextUint() >> 8U) * 0x1.0p-24F;
+  }
+
+private:
+  void Advance() noexcept {
+    state_ = state_ * 6364136223846793005ULL + increment_;
+  }
+
+private:
+  std::uint64_t state_;
+  std::uint64_t increment_;
+};
+
+#endif
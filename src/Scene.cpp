@@ -1,25 +1,207 @@
 #include "Scene.h"
 
 // STL
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+// glm
+#include "glm/vec3.hpp"
+
 // src
+#include "EnvironmentMap.h"
 #include "IRayTraceable.h"
+#include "JobSystem.h"
+#include "Kernels.h"
+#include "LightTree.h"
+#include "PagedGeometry.h"
+#include "Ray.h"
+#include "Sphere.h"
+#include "SphereBvh.h"
+
+namespace {
+
+bool IsEmissive(const Material& material) noexcept {
+  return material.emission.r > 0.0F || material.emission.g > 0.0F
+         || material.emission.b > 0.0F;
+}
+
+template <typename T>
+void ApplyOrder(std::vector<T>& values, const std::vector<std::uint32_t>& order) {
+  std::vector<T> ordered_values{};
+  ordered_values.reserve(values.size());
+  for (const std::uint32_t index : order) {
+    ordered_values.emplace_back(values[index]);
+  }
+  values = std::move(ordered_values);
+}
+
+// Distance at which a ray enters a node's bounds, or infinity if it
+// misses them within the distance range
+float ComputeEntryDistance(
+    const BvhNode& node,
+    const float* origin,
+    const float* inverse_direction,
+    float min_distance,
+    float max_distance) {
+  float entry{ min_distance };
+  float exit{ max_distance };
+  for (std::size_t axis{ 0U }; axis < 3U; ++axis) {
+    const float near_plane{ (node.bounds_min[axis] - origin[axis]) * inverse_direction[axis] };
+    const float far_plane{ (node.bounds_max[axis] - origin[axis]) * inverse_direction[axis] };
+    entry = std::max(entry, std::min(near_plane, far_plane));
+    exit = std::min(exit, std::max(near_plane, far_plane));
+  }
+
+  return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+}
+
+}  // namespace
 
 void Scene::AddObject(const std::shared_ptr<IRayTraceable>& object) {
   ray_traceables_.emplace_back(object);
 }
 
+void Scene::AddSphere(const Sphere& sphere, std::string_view name) {
+  // Start keeping names with the first named sphere
+  if (!name.empty() && sphere_names_.empty()) {
+    sphere_names_.resize(sphere_count());
+  }
+  if (!sphere_names_.empty()) {
+    sphere_names_.emplace_back(name);
+  }
+
+  sphere_center_x_.emplace_back(sphere.center().x);
+  sphere_center_y_.emplace_back(sphere.center().y);
+  sphere_center_z_.emplace_back(sphere.center().z);
+  sphere_radius_.emplace_back(sphere.radius());
+  sphere_materials_.emplace_back(sphere.material());
+}
+
+void Scene::AddPagedGeometry(const std::shared_ptr<PagedGeometry>& geometry) {
+  ray_traceables_.emplace_back(geometry);
+  paged_geometries_.emplace_back(geometry);
+}
+
+void Scene::SetEnvironment(std::shared_ptr<const EnvironmentMap> environment) {
+  environment_ = std::move(environment);
+}
+
+void Scene::SetTextureCache(std::shared_ptr<TextureCache> texture_cache) {
+  texture_cache_ = std::move(texture_cache);
+}
+
+void Scene::AddInputFile(const std::filesystem::path& path) {
+  input_files_.emplace_back(path);
+}
+
+void Scene::Build(JobSystem* jobs, std::atomic<float>* progress) {
+  // Build the sphere hierarchy and rearrange spheres into its leaf order
+  std::vector<std::uint32_t> order{};
+  bvh_.Build(GetSphereArrays(), jobs, progress, order);
+  ApplyOrder(sphere_center_x_, order);
+  ApplyOrder(sphere_center_y_, order);
+  ApplyOrder(sphere_center_z_, order);
+  ApplyOrder(sphere_radius_, order);
+  ApplyOrder(sphere_materials_, order);
+  if (!sphere_names_.empty()) {
+    ApplyOrder(sphere_names_, order);
+  }
+
+  // Remember where each sphere was added, including spheres added since
+  // an earlier build
+  for (std::size_t i{ sphere_source_indices_.size() }; i < order.size(); ++i) {
+    sphere_source_indices_.emplace_back(static_cast<std::uint32_t>(i));
+  }
+  ApplyOrder(sphere_source_indices_, order);
+
+  // Collect emissive spheres into the light tree
+  light_spheres_.clear();
+  for (std::size_t i{ 0U }; i < sphere_count(); ++i) {
+    if (IsEmissive(sphere_materials_[i])) {
+      light_spheres_.emplace_back(i);
+    }
+  }
+  BuildLightTree();
+}
+
+void Scene::UpdateSpheres(const std::vector<SphereEdit>& edits) {
+  std::vector<std::uint32_t> edited_spheres{};
+  edited_spheres.reserve(edits.size());
+  bool lights_changed{ false };
+  for (const SphereEdit& edit : edits) {
+    if (edit.index >= sphere_count()) {
+      continue;
+    }
+
+    // Lights stay in the light tree while they remain emissive
+    const bool was_emissive{ IsEmissive(sphere_materials_[edit.index]) };
+    const bool is_emissive{ IsEmissive(edit.sphere.material()) };
+    if (is_emissive && !was_emissive) {
+      light_spheres_.emplace_back(edit.index);
+    } else if (was_emissive && !is_emissive) {
+      std::erase(light_spheres_, edit.index);
+    }
+    lights_changed |= was_emissive || is_emissive;
+
+    sphere_center_x_[edit.index] = edit.sphere.center().x;
+    sphere_center_y_[edit.index] = edit.sphere.center().y;
+    sphere_center_z_[edit.index] = edit.sphere.center().z;
+    sphere_radius_[edit.index] = edit.sphere.radius();
+    sphere_materials_[edit.index] = edit.sphere.material();
+    edited_spheres.emplace_back(static_cast<std::uint32_t>(edit.index));
+  }
+
+  bvh_.Refit(GetSphereArrays(), edited_spheres);
+  if (lights_changed) {
+    BuildLightTree();
+  }
+}
+
 std::optional<TraceResult> Scene::TraceRay(
     const Ray& ray,
     float min_distance,
     float max_distance) const {
   TraceResult trace_result{};
 
-  // Test ray intersection with every ray traceable object
+  // Test ray intersection with the packed spheres
   bool hit_anything{ false };
+  if (sphere_count() > 0U) {
+    const float origin[3]{ ray.origin().x, ray.origin().y, ray.origin().z };
+    const float direction[3]{
+      ray.direction().x, ray.direction().y, ray.direction().z
+    };
+
+    float distance{};
+    const std::size_t sphere_index{
+      IntersectSpheres(origin, direction, min_distance, max_distance, &distance)
+    };
+    if (sphere_index != kNoHit) {
+      hit_anything = true;
+      trace_result = Sphere::ResolveTraceResult(
+        ray,
+        glm::vec3{ sphere_center_x_[sphere_index],
+                   sphere_center_y_[sphere_index],
+                   sphere_center_z_[sphere_index] },
+        sphere_radius_[sphere_index],
+        sphere_materials_[sphere_index],
+        distance
+      );
+      trace_result.primitive_index = sphere_index;
+      max_distance = trace_result.distance;
+    }
+  }
+
+  // Test ray intersection with every other ray traceable object
   for (const std::shared_ptr<IRayTraceable>& ray_traceable : ray_traceables_) {
     const std::optional<TraceResult> local_trace_result{
       ray_traceable->TraceRay(ray, min_distance, max_distance)
@@ -41,3 +223,132 @@ std::optional<TraceResult> Scene::TraceRay(
 
   return trace_result;
 }
+
+Sphere Scene::GetSphere(std::size_t index) const {
+  return Sphere{
+    glm::vec3{ sphere_center_x_[index], sphere_center_y_[index], sphere_center_z_[index] },
+    sphere_radius_[index],
+    sphere_materials_[index]
+  };
+}
+
+SphereArrays Scene::GetSphereArrays() const noexcept {
+  return SphereArrays{
+    sphere_center_x_.data(),
+    sphere_center_y_.data(),
+    sphere_center_z_.data(),
+    sphere_radius_.data(),
+    sphere_radius_.size()
+  };
+}
+
+void Scene::BuildLightTree() {
+  std::vector<SphereLight> lights{};
+  lights.reserve(light_spheres_.size());
+  for (const std::size_t i : light_spheres_) {
+    lights.emplace_back(SphereLight{
+      glm::vec3{ sphere_center_x_[i], sphere_center_y_[i], sphere_center_z_[i] },
+      sphere_radius_[i],
+      sphere_materials_[i].emission,
+      i
+    });
+  }
+  light_tree_ = LightTree{ std::move(lights) };
+}
+
+std::size_t Scene::IntersectSpheres(
+    const float* origin,
+    const float* direction,
+    float min_distance,
+    float max_distance,
+    float* out_distance) const {
+  const KernelTable& kernels{ GetKernels() };
+
+  // Without a hierarchy, test all spheres at once
+  if (bvh_.empty()) {
+    return kernels.intersect_spheres(GetSphereArrays(),
+                                     origin, direction,
+                                     min_distance, max_distance,
+                                     out_distance);
+  }
+
+  const float inverse_direction[3]{
+    1.0F / direction[0], 1.0F / direction[1], 1.0F / direction[2]
+  };
+  const std::vector<BvhNode>& nodes{ bvh_.nodes() };
+
+  std::size_t nearest_index{ kNoHit };
+  float nearest_distance{ max_distance };
+
+  // Nodes still to visit along with the distance the ray enters them
+  struct StackEntry {
+    std::uint32_t node;
+    float entry_distance;
+  };
+  StackEntry stack[64];
+  std::size_t stack_size{ 0U };
+
+  const float root_entry{
+    ComputeEntryDistance(nodes[0], origin, inverse_direction,
+                         min_distance, nearest_distance)
+  };
+  if (root_entry < nearest_distance) {
+    stack[stack_size++] = StackEntry{ 0U, root_entry };
+  }
+
+  while (stack_size > 0U) {
+    const StackEntry entry{ stack[--stack_size] };
+    // Skip nodes behind a hit found since they were pushed
+    if (entry.entry_distance >= nearest_distance) {
+      continue;
+    }
+
+    // Intersect the leaf's contiguous spheres with the kernel
+    const BvhNode& node{ nodes[entry.node] };
+    if (node.count > 0U) {
+      const SphereArrays leaf_spheres{
+        sphere_center_x_.data() + node.first,
+        sphere_center_y_.data() + node.first,
+        sphere_center_z_.data() + node.first,
+        sphere_radius_.data() + node.first,
+        node.count
+      };
+      float distance{};
+      const std::size_t leaf_index{
+        kernels.intersect_spheres(leaf_spheres, origin, direction,
+                                  min_distance, nearest_distance, &distance)
+      };
+      if (leaf_index != kNoHit) {
+        nearest_index = node.first + leaf_index;
+        nearest_distance = distance;
+      }
+      continue;
+    }
+
+    // Push the farther child first so the nearer one is visited next
+    StackEntry near_child{
+      node.first,
+      ComputeEntryDistance(nodes[node.first], origin, inverse_direction,
+                           min_distance, nearest_distance)
+    };
+    StackEntry far_child{
+      node.first + 1U,
+      ComputeEntryDistance(nodes[node.first + 1U], origin, inverse_direction,
+                           min_distance, nearest_distance)
+    };
+    if (far_child.entry_distance < near_child.entry_distance) {
+      std::swap(near_child, far_child);
+    }
+    if (far_child.entry_distance < nearest_distance) {
+      stack[stack_size++] = far_child;
+    }
+    if (near_child.entry_distance < nearest_distance) {
+      stack[stack_size++] = near_child;
+    }
+  }
+
+  if (nearest_index != kNoHit) {
+    *out_distance = nearest_distance;
+  }
+  return nearest_index;
+}
@@ -2,14 +2,35 @@
 #define SCENE_H
 
 // STL
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <vector>
 
+// src
+#include "IRayTraceable.h"
+#include "Kernels.h"
+#include "LightTree.h"
+#include "Sphere.h"
+#include "SphereBvh.h"
+
 // Forward declarations
+class EnvironmentMap;
+class JobSystem;
+class PagedGeometry;
 class Ray;
-class IRayTraceable;
-struct TraceResult;
+class TextureCache;
+
+// Replaces the packed sphere at index, as made in the editor
+struct SphereEdit {
+  std::size_t index;
+  Sphere sphere;
+};
 
 class Scene {
 public:
@@ -17,14 +38,137 @@ public:
 
   void AddObject(const std::shared_ptr<IRayTraceable>& object);
 
+  // Spheres are stored packed rather than behind IRayTraceable so they
+  // can be intersected in bulk by the dispatched kernels. Names are
+  // optional and only shown in the editor.
+  void AddSphere(const Sphere& sphere, std::string_view name = {});
+
+  // Paged geometry is traced alongside the in-memory objects, with its
+  // clusters read from disk on demand
+  void AddPagedGeometry(const std::shared_ptr<PagedGeometry>& geometry);
+
+  void SetEnvironment(std::shared_ptr<const EnvironmentMap> environment);
+
+  // Cache the materials' texture ids refer to
+  void SetTextureCache(std::shared_ptr<TextureCache> texture_cache);
+
+  // Records a file the scene was built from, such as an environment map
+  // or texture, so callers can tell whether its inputs changed
+  void AddInputFile(const std::filesystem::path& path);
+
+  // Builds the structures derived from the scene's objects, i.e. the
+  // sphere hierarchy and the light tree; must be called after the last
+  // object has been added. Building reorders spheres, and uses jobs for
+  // large hierarchies if given while advancing progress from 0 to 1.
+  void Build(JobSystem* jobs = nullptr, std::atomic<float>* progress = nullptr);
+
+  // Applies edits to built spheres in place, in order. Only the hierarchy
+  // nodes above the edited spheres are refitted, and the light tree is
+  // only rebuilt if a light was edited, so the cost does not grow with
+  // the size of the scene. Must not be called while the scene is traced.
+  void UpdateSpheres(const std::vector<SphereEdit>& edits);
+
   [[nodiscard]]
   std::optional<TraceResult> TraceRay(
     const Ray& ray,
     float min_distance,
     float max_distance) const;
 
+  // Environment lighting rays escaping the scene; null if the default
+  // background gradient should be used instead
+  [[nodiscard]]
+  const std::shared_ptr<const EnvironmentMap>& environment() const noexcept {
+    return environment_;
+  }
+
+  // Null if no material is textured
+  [[nodiscard]]
+  const std::shared_ptr<TextureCache>& texture_cache() const noexcept {
+    return texture_cache_;
+  }
+
+  // Hierarchy over all emissive spheres, valid after Build()
+  [[nodiscard]]
+  const LightTree& light_tree() const noexcept {
+    return light_tree_;
+  }
+
+  [[nodiscard]]
+  const std::vector<std::filesystem::path>& input_files() const noexcept {
+    return input_files_;
+  }
+
+  [[nodiscard]]
+  const std::vector<std::shared_ptr<PagedGeometry>>& paged_geometries() const noexcept {
+    return paged_geometries_;
+  }
+
+  [[nodiscard]]
+  std::size_t sphere_count() const noexcept {
+    return sphere_radius_.size();
+  }
+
+  [[nodiscard]]
+  Sphere GetSphere(std::size_t index) const;
+
+  // Name given in the scene file; empty if the sphere has none
+  [[nodiscard]]
+  std::string_view sphere_name(std::size_t index) const noexcept {
+    return index < sphere_names_.size() ? std::string_view{ sphere_names_[index] }
+                                        : std::string_view{};
+  }
+
+  // Position the sphere was added at, e.g. its line among the scene
+  // file's spheres, which Build() does not change
+  [[nodiscard]]
+  std::size_t sphere_source_index(std::size_t index) const noexcept {
+    return index < sphere_source_indices_.size() ? sphere_source_indices_[index] : index;
+  }
+
+  [[nodiscard]]
+  SphereArrays GetSphereArrays() const noexcept;
+
+  [[nodiscard]]
+  const std::vector<Material>& sphere_materials() const noexcept {
+    return sphere_materials_;
+  }
+
+private:
+  // Rebuilds the light tree over the spheres in light_spheres_
+  void BuildLightTree();
+
+  // Finds the nearest packed sphere hit within the distance range,
+  // walking the hierarchy if it has been built
+  [[nodiscard]]
+  std::size_t IntersectSpheres(
+    const float* origin,
+    const float* direction,
+    float min_distance,
+    float max_distance,
+    float* out_distance) const;
+
 private:
   std::vector<std::shared_ptr<IRayTraceable>> ray_traceables_;
+  std::vector<std::shared_ptr<PagedGeometry>> paged_geometries_;
+
+  std::vector<float> sphere_center_x_;
+  std::vector<float> sphere_center_y_;
+  std::vector<float> sphere_center_z_;
+  std::vector<float> sphere_radius_;
+  std::vector<Material> sphere_materials_;
+  // Empty until a named sphere is added, as most spheres have no name
+  std::vector<std::string> sphere_names_;
+  // Empty until Build() first reorders the spheres
+  std::vector<std::uint32_t> sphere_source_indices_;
+  // Indices of emissive spheres, valid after Build()
+  std::vector<std::size_t> light_spheres_;
+
+  std::shared_ptr<const EnvironmentMap> environment_;
+  std::shared_ptr<TextureCache> texture_cache_;
+  // In the order they were added
+  std::vector<std::filesystem::path> input_files_;
+  SphereBvh bvh_;
+  LightTree light_tree_;
 };
 
 #endif
@@ -0,0 +1,100 @@
+#include "SceneCache.h"
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// src
+#include "JobSystem.h"
+#include "Scene.h"
+#include "SceneLoader.h"
+
+SceneCache::SceneCache(JobSystem& jobs, std::size_t capacity)
+    : jobs_{ jobs }
+    , capacity_{ capacity }
+    , hits_{ 0U }
+    , misses_{ 0U }
+    , evictions_{ 0U } {}
+
+std::shared_ptr<const Scene> SceneCache::Get(
+    const std::filesystem::path& path,
+    bool* was_cached) {
+  const std::optional<std::uint64_t> hash{ HashSceneFile(path) };
+  if (!hash.has_value()) {
+    return nullptr;
+  }
+
+  // Scenes already loaded or loading are marked most recently used.
+  // Otherwise, the pending load is published so concurrent requests wait
+  // on it, and least recently used scenes are evicted; renders still
+  // using an evicted scene keep it alive until they finish.
+  std::promise<std::shared_ptr<const Scene>> promise{};
+  SceneFuture scene_future{};
+  std::uint64_t load{ 0U };
+  bool needs_load{ false };
+  {
+    const std::scoped_lock lock{ mutex_ };
+    if (const auto entry{ entries_.find(hash.value()) }; entry != entries_.end()) {
+      lru_.splice(lru_.begin(), lru_, entry->second);
+      scene_future = entry->second->second.scene;
+      ++hits_;
+    } else {
+      scene_future = promise.get_future().share();
+      load = misses_;
+      lru_.emplace_front(hash.value(), Entry{ scene_future, load });
+      entries_.emplace(hash.value(), lru_.begin());
+      while (lru_.size() > capacity_ && lru_.size() > 1U) {
+        entries_.erase(lru_.back().first);
+        lru_.pop_back();
+        ++evictions_;
+      }
+      needs_load = true;
+      ++misses_;
+    }
+  }
+  if (was_cached) {
+    *was_cached = !needs_load;
+  }
+  if (!needs_load) {
+    return scene_future.get();
+  }
+
+  // Load without holding the lock so other scenes can be served meanwhile.
+  // A load that throws, e.g. running out of memory, counts as failed, so
+  // requests waiting on it are answered too.
+  std::shared_ptr<const Scene> scene{};
+  try {
+    scene = LoadScene(path, &jobs_, nullptr);
+  } catch (const std::exception& exception) {
+    spdlog::error("Failed to load scene {}: {}", path.string(), exception.what());
+  }
+  promise.set_value(scene);
+
+  // Do not keep failed loads, so a fixed file is picked up next time. The
+  // entry may have been evicted meanwhile and the scene requested again,
+  // in which case the entry belongs to that load.
+  if (!scene) {
+    const std::scoped_lock lock{ mutex_ };
+    if (const auto entry{ entries_.find(hash.value()) };
+        entry != entries_.end() && entry->second->second.load == load) {
+      lru_.erase(entry->second);
+      entries_.erase(entry);
+    }
+  }
+
+  return scene;
+}
+
+SceneCacheStats SceneCache::GetStats() {
+  const std::scoped_lock lock{ mutex_ };
+  return SceneCacheStats{ hits_, misses_, evictions_, lru_.size(), capacity_ };
+}
@@ -0,0 +1,79 @@
+#ifndef SCENECACHE_H
+#define SCENECACHE_H
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+// Forward declarations
+class JobSystem;
+class Scene;
+
+struct SceneCacheStats {
+  std::uint64_t hits;
+  std::uint64_t misses;
+  std::uint64_t evictions;
+  std::size_t resident_scenes;
+  std::size_t capacity;
+};
+
+// Keeps the most recently used scenes loaded, with their acceleration
+// structures built, for renders that reuse them.
+//
+// Scenes are keyed by a hash of the scene file's contents and directory,
+// so editing a file loads it afresh while renaming does not. Files a scene
+// references (environment maps, paged geometry) are assumed not to change
+// while it is cached. Requests for a scene that is still loading wait for
+// that load instead of starting another.
+class SceneCache {
+public:
+  SceneCache() = delete;
+  SceneCache(JobSystem& jobs, std::size_t capacity);
+
+  SceneCache(const SceneCache&) = delete;
+  SceneCache& operator=(const SceneCache&) = delete;
+
+  // Returns the scene, loading and building it on a miss; null if it
+  // failed to load. was_cached, if given, is set on a hit. May block on
+  // another thread's load, so it must not be called from a pool job.
+  [[nodiscard]]
+  std::shared_ptr<const Scene> Get(
+    const std::filesystem::path& path,
+    bool* was_cached = nullptr);
+
+  [[nodiscard]]
+  SceneCacheStats GetStats();
+
+private:
+  using SceneFuture = std::shared_future<std::shared_ptr<const Scene>>;
+
+  struct Entry {
+    SceneFuture scene;
+    // Numbers each load, so a failed one only removes its own entry and
+    // not a later load of the same scene
+    std::uint64_t load;
+  };
+
+  using LruList = std::list<std::pair<std::uint64_t, Entry>>;
+
+private:
+  JobSystem& jobs_;
+  std::size_t capacity_;
+
+  std::mutex mutex_;
+  LruList lru_;
+  std::unordered_map<std::uint64_t, LruList::iterator> entries_;
+
+  std::uint64_t hits_;
+  std::uint64_t misses_;
+  std::uint64_t evictions_;
+};
+
+#endif
@@ -0,0 +1,361 @@
+#include "SceneLoader.h"
+
+// STL
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+// glm
+#include "glm/vec3.hpp"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// src
+#include "EnvironmentMap.h"
+#include "IRayTraceable.h"
+#include "JobSystem.h"
+#include "PagedGeometry.h"
+#include "Scene.h"
+#include "Sphere.h"
+#include "TextureCache.h"
+
+namespace {
+
+// Number of lines parsed between progress updates
+constexpr std::size_t kProgressInterval{ 4096U };
+
+// Splits whitespace separated tokens off the front of a line
+class Tokenizer {
+public:
+  explicit Tokenizer(std::string_view line) : remaining_{ line } {}
+
+  [[nodiscard]]
+  std::optional<std::string_view> Next() {
+    const std::size_t begin{ remaining_.find_first_not_of(" \t\r") };
+    if (begin == std::string_view::npos) {
+      remaining_ = {};
+      return std::nullopt;
+    }
+    remaining_.remove_prefix(begin);
+
+    const std::size_t end{ std::min(remaining_.find_first_of(" \t\r"), remaining_.size()) };
+    const std::string_view token{ remaining_.substr(0U, end) };
+    remaining_.remove_prefix(end);
+    return token;
+  }
+
+  [[nodiscard]]
+  std::optional<float> NextFloat() {
+    const std::optional<std::string_view> token{ Next() };
+    if (!token.has_value()) {
+      return std::nullopt;
+    }
+
+    float value{};
+    const std::from_chars_result result{
+      std::from_chars(token->data(), token->data() + token->size(), value)
+    };
+    if (result.ec != std::errc{} || result.ptr != token->data() + token->size()
+        || !std::isfinite(value)) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  [[nodiscard]]
+  std::optional<std::uint64_t> NextInteger() {
+    const std::optional<std::string_view> token{ Next() };
+    if (!token.has_value()) {
+      return std::nullopt;
+    }
+
+    std::uint64_t value{};
+    const std::from_chars_result result{
+      std::from_chars(token->data(), token->data() + token->size(), value)
+    };
+    if (result.ec != std::errc{} || result.ptr != token->data() + token->size()) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  [[nodiscard]]
+  std::optional<glm::vec3> NextVec3() {
+    const std::optional<float> x{ NextFloat() };
+    const std::optional<float> y{ NextFloat() };
+    const std::optional<float> z{ NextFloat() };
+    if (!x.has_value() || !y.has_value() || !z.has_value()) {
+      return std::nullopt;
+    }
+    return glm::vec3{ x.value(), y.value(), z.value() };
+  }
+
+private:
+  std::string_view remaining_;
+};
+
+// Textures opened so far, so spheres sharing a file share its tiles
+struct SceneTextures {
+  std::shared_ptr<TextureCache> cache;
+  std::unordered_map<std::string, TextureId> ids;
+};
+
+std::optional<TextureId> OpenTexture(
+    const std::filesystem::path& path,
+    SceneTextures& textures,
+    Scene& scene) {
+  const std::string key{ path.lexically_normal().string() };
+  if (const auto id{ textures.ids.find(key) }; id != textures.ids.end()) {
+    return id->second;
+  }
+
+  if (!textures.cache) {
+    textures.cache = std::make_shared<TextureCache>(TextureCache::kDefaultCapacityBytes);
+  }
+  const std::optional<TextureId> id{ textures.cache->Open(path) };
+  if (id.has_value()) {
+    textures.ids.emplace(key, id.value());
+    scene.AddInputFile(path);
+  }
+  return id;
+}
+
+bool ParseSphere(
+    Tokenizer& tokenizer,
+    const std::filesystem::path& scene_path,
+    SceneTextures& textures,
+    Scene& scene) {
+  const std::optional<glm::vec3> center{ tokenizer.NextVec3() };
+  const std::optional<float> radius{ tokenizer.NextFloat() };
+  if (!center.has_value() || !radius.has_value() || radius.value() <= 0.0F) {
+    return false;
+  }
+
+  // Optional name and material properties
+  Material material{};
+  std::string_view name{};
+  while (const std::optional<std::string_view> property{ tokenizer.Next() }) {
+    if (property.value() == "name") {
+      const std::optional<std::string_view> value{ tokenizer.Next() };
+      if (!value.has_value()) {
+        return false;
+      }
+      name = value.value();
+      continue;
+    }
+    if (property.value() == "texture") {
+      const std::optional<std::string_view> value{ tokenizer.Next() };
+      if (!value.has_value()) {
+        return false;
+      }
+      const std::optional<TextureId> texture{
+        OpenTexture(scene_path.parent_path() / value.value(), textures, scene)
+      };
+      if (!texture.has_value()) {
+        return false;
+      }
+      material.albedo_texture = texture.value();
+      continue;
+    }
+
+    const std::optional<glm::vec3> value{ tokenizer.NextVec3() };
+    if (!value.has_value()) {
+      return false;
+    }
+
+    if (property.value() == "albedo") {
+      material.albedo = value.value();
+    } else if (property.value() == "emission") {
+      material.emission = value.value();
+    } else {
+      return false;
+    }
+  }
+
+  scene.AddSphere(Sphere{ center.value(), radius.value(), material }, name);
+  return true;
+}
+
+bool ParseGeometry(
+    Tokenizer& tokenizer,
+    const std::filesystem::path& scene_path,
+    Scene& scene) {
+  const std::optional<std::string_view> geometry_path{ tokenizer.Next() };
+  if (!geometry_path.has_value()) {
+    return false;
+  }
+
+  // Optional cache size in whole MiB, which must not overflow once
+  // converted to bytes
+  constexpr std::uint64_t kMaxCapacityMib{ std::numeric_limits<std::size_t>::max()
+                                           / (1024U * 1024U) };
+  std::size_t capacity_bytes{ PagedGeometry::kDefaultCapacityBytes };
+  if (const std::optional<std::string_view> capacity_token{ tokenizer.Next() }) {
+    Tokenizer capacity_tokenizer{ capacity_token.value() };
+    const std::optional<std::uint64_t> capacity_mib{ capacity_tokenizer.NextInteger() };
+    if (!capacity_mib.has_value() || capacity_mib.value() == 0U
+        || capacity_mib.value() > kMaxCapacityMib || tokenizer.Next().has_value()) {
+      return false;
+    }
+    capacity_bytes = static_cast<std::size_t>(capacity_mib.value()) * 1024U * 1024U;
+  }
+
+  const std::filesystem::path full_geometry_path{
+    scene_path.parent_path() / geometry_path.value()
+  };
+  const std::shared_ptr<PagedGeometry> geometry{
+    PagedGeometry::Open(full_geometry_path, capacity_bytes)
+  };
+  if (!geometry) {
+    return false;
+  }
+  scene.AddPagedGeometry(geometry);
+  scene.AddInputFile(full_geometry_path);
+  return true;
+}
+
+void ReportProgress(SceneLoadProgress* progress, SceneLoadStage stage, float fraction) {
+  if (progress) {
+    progress->fraction.store(fraction, std::memory_order_relaxed);
+    progress->stage.store(stage, std::memory_order_release);
+  }
+}
+
+}  // namespace
+
+std::shared_ptr<Scene> LoadScene(
+    const std::filesystem::path& path,
+    JobSystem* jobs,
+    SceneLoadProgress* progress) {
+  ReportProgress(progress, SceneLoadStage::kParsing, 0.0F);
+
+  std::ifstream scene_file{ path };
+  if (!scene_file) {
+    spdlog::error("Failed to open scene {}.", path.string());
+    ReportProgress(progress, SceneLoadStage::kFailed, 0.0F);
+    return nullptr;
+  }
+
+  std::error_code error{};
+  const std::uintmax_t file_size{ std::filesystem::file_size(path, error) };
+
+  // Stream statements in line by line
+  std::shared_ptr<Scene> scene{ std::make_shared<Scene>() };
+  SceneTextures textures{};
+  std::string line{};
+  std::size_t line_number{ 0U };
+  while (std::getline(scene_file, line)) {
+    ++line_number;
+
+    // Strip comments
+    const std::string_view statement{
+      std::string_view{ line }.substr(0U, line.find('#'))
+    };
+    Tokenizer tokenizer{ statement };
+    const std::optional<std::string_view> keyword{ tokenizer.Next() };
+    if (!keyword.has_value()) {
+      continue;
+    }
+
+    bool parsed{ false };
+    if (keyword.value() == "sphere") {
+      parsed = ParseSphere(tokenizer, path, textures, *scene);
+    } else if (keyword.value() == "geometry") {
+      parsed = ParseGeometry(tokenizer, path, *scene);
+    } else if (keyword.value() == "environment") {
+      const std::optional<std::string_view> environment_path{ tokenizer.Next() };
+      if (environment_path.has_value()) {
+        const std::filesystem::path full_environment_path{
+          path.parent_path() / environment_path.value()
+        };
+        std::shared_ptr<EnvironmentMap> environment{
+          EnvironmentMap::Load(full_environment_path)
+        };
+        parsed = static_cast<bool>(environment);
+        scene->SetEnvironment(std::move(environment));
+        scene->AddInputFile(full_environment_path);
+      }
+    }
+
+    if (!parsed) {
+      spdlog::error("Scene {} has an invalid statement on line {}.",
+                    path.string(), line_number);
+      ReportProgress(progress, SceneLoadStage::kFailed, 0.0F);
+      return nullptr;
+    }
+
+    if (line_number % kProgressInterval == 0U && file_size > 0U) {
+      const std::streamoff position{ scene_file.tellg() };
+      ReportProgress(progress, SceneLoadStage::kParsing,
+                     static_cast<float>(position) / static_cast<float>(file_size));
+    }
+  }
+
+  scene->SetTextureCache(std::move(textures.cache));
+
+  // Build acceleration structures
+  ReportProgress(progress, SceneLoadStage::kBuilding, 0.0F);
+  scene->Build(jobs, progress ? &progress->fraction : nullptr);
+
+  spdlog::info("Loaded scene {} with {} spheres and {} lights.",
+               path.string(), scene->sphere_count(), scene->light_tree().size());
+  ReportProgress(progress, SceneLoadStage::kDone, 1.0F);
+  return scene;
+}
+
+std::optional<std::uint64_t> HashSceneFile(const std::filesystem::path& path) {
+  std::ifstream input_file{ path, std::ios::binary };
+  if (!input_file) {
+    spdlog::error("Failed to open scene {}.", path.string());
+    return std::nullopt;
+  }
+
+  // The directory matters because statements resolve their paths
+  // relative to it
+  std::error_code error{};
+  const std::string directory{
+    std::filesystem::weakly_canonical(path, error).parent_path().string()
+  };
+  std::uint64_t hash{ HashSceneBytes(kSceneHashBasis, directory.data(), directory.size()) };
+
+  char buffer[65536];
+  while (input_file) {
+    input_file.read(buffer, sizeof(buffer));
+    hash = HashSceneBytes(hash, buffer, static_cast<std::size_t>(input_file.gcount()));
+  }
+
+  return hash;
+}
+
+std::uint64_t HashSceneBytes(std::uint64_t hash, const void* bytes, std::size_t count) {
+  constexpr std::uint64_t kFnvPrime{ 0x100000001B3ULL };
+  const std::uint8_t* const byte_data{ static_cast<const std::uint8_t*>(bytes) };
+  for (std::size_t i{ 0U }; i < count; ++i) {
+    hash = (hash ^ byte_data[i]) * kFnvPrime;
+  }
+  return hash;
+}
+
+std::string_view ToString(SceneLoadStage stage) noexcept {
+  switch (stage) {
+    case SceneLoadStage::kIdle: { return "Idle"; }
+    case SceneLoadStage::kParsing: { return "Parsing"; }
+    case SceneLoadStage::kBuilding: { return "Building acceleration structures"; }
+    case SceneLoadStage::kDone: { return "Done"; }
+    case SceneLoadStage::kFailed: { return "Failed"; }
+    default: { return "Unknown"; }
+  }
+}
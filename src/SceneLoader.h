@@ -0,0 +1,63 @@
+#ifndef SCENELOADER_H
+#define SCENELOADER_H
+
+// STL
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+// Forward declarations
+class JobSystem;
+class Scene;
+
+enum class SceneLoadStage {
+  kIdle,
+  kParsing,
+  kBuilding,
+  kDone,
+  kFailed
+};
+
+// Progress of a scene load, safe to poll from another thread
+struct SceneLoadProgress {
+  std::atomic<SceneLoadStage> stage{ SceneLoadStage::kIdle };
+  // Completed fraction of the current stage, from 0 to 1
+  std::atomic<float> fraction{ 0.0F };
+};
+
+// Streams a scene file in and builds its acceleration structures,
+// reporting progress as it goes. Scene files are plain text, one
+// statement per line; '#' starts a comment:
+//
+//   environment <path to .hdr, relative to the scene file>
+//   geometry <path to .rtgeo, relative to the scene file> [cache size in MiB]
+//   sphere <x> <y> <z> <radius> [albedo <r> <g> <b>] [emission <r> <g> <b>]
+//          [texture <path to .rtex, relative to the scene file>] [name <name>]
+//
+// Textures multiply the albedo, mapped by latitude and longitude.
+[[nodiscard]]
+std::shared_ptr<Scene> LoadScene(
+  const std::filesystem::path& path,
+  JobSystem* jobs,
+  SceneLoadProgress* progress);
+
+// Identifies a scene file by an FNV-1a hash of its contents and of the
+// directory its statements resolve paths against. Files it references are
+// assumed not to change. Empty if the file cannot be read.
+[[nodiscard]]
+std::optional<std::uint64_t> HashSceneFile(const std::filesystem::path& path);
+
+// Folds bytes into an FNV-1a hash, e.g. one returned by HashSceneFile()
+// or starting from kSceneHashBasis
+inline constexpr std::uint64_t kSceneHashBasis{ 0xCBF29CE484222325ULL };
+[[nodiscard]]
+std::uint64_t HashSceneBytes(std::uint64_t hash, const void* bytes, std::size_t count);
+
+[[nodiscard]]
+std::string_view ToString(SceneLoadStage stage) noexcept;
+
+#endif
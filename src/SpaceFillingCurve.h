@@ -0,0 +1,72 @@
+#ifndef SPACEFILLINGCURVE_H
+#define SPACEFILLINGCURVE_H
+
+// STL
+#include <cstdint>
+#include <utility>
+
+// Spreads the lower 16 bits of value out to every other bit
+[[nodiscard]]
+inline constexpr std::uint32_t SpreadBits2D(std::uint32_t value) noexcept {
+  value &= 0x0000FFFFU;
+  value = (value | (value << 8U)) & 0x00FF00FFU;
+  value = (value | (value << 4U)) & 0x0F0F0F0FU;
+  value = (value | (value << 2U)) & 0x33333333U;
+  value = (value | (value << 1U)) & 0x55555555U;
+  return value;
+}
+
+// Spreads the lower 10 bits of value out to every third bit
+[[nodiscard]]
+inline constexpr std::uint32_t SpreadBits3D(std::uint32_t value) noexcept {
+  value &= 0x000003FFU;
+  value = (value | (value << 16U)) & 0x030000FFU;
+  value = (value | (value << 8U)) & 0x0300F00FU;
+  value = (value | (value << 4U)) & 0x030C30C3U;
+  value = (value | (value << 2U)) & 0x09249249U;
+  return value;
+}
+
+// Index of (x, y) along a Z-order curve; coordinates must be below 2^16
+[[nodiscard]]
+inline constexpr std::uint32_t MortonEncode2D(std::uint32_t x, std::uint32_t y) noexcept {
+  return SpreadBits2D(x) | (SpreadBits2D(y) << 1U);
+}
+
+// Index of (x, y, z) along a Z-order curve; coordinates must be below 2^10
+[[nodiscard]]
+inline constexpr std::uint32_t MortonEncode3D(
+    std::uint32_t x,
+    std::uint32_t y,
+    std::uint32_t z) noexcept {
+  return SpreadBits3D(x) | (SpreadBits3D(y) << 1U) | (SpreadBits3D(z) << 2U);
+}
+
+// Index of (x, y) along a Hilbert curve filling a size by size grid, where
+// size is a power of two. Unlike the Z-order curve, consecutive indices
+// are always neighbouring cells.
+[[nodiscard]]
+inline constexpr std::uint32_t HilbertEncode2D(
+    std::uint32_t size,
+    std::uint32_t x,
+    std::uint32_t y) noexcept {
+  std::uint32_t index{ 0U };
+  for (std::uint32_t half{ size / 2U }; half > 0U; half /= 2U) {
+    const std::uint32_t right{ (x & half) != 0U ? 1U : 0U };
+    const std::uint32_t bottom{ (y & half) != 0U ? 1U : 0U };
+    index += half * half * ((3U * right) ^ bottom);
+
+    // Rotate the quadrant so the sub-curves join up end to end
+    if (bottom == 0U) {
+      if (right == 1U) {
+        x = size - 1U - x;
+        y = size - 1U - y;
+      }
+      std::swap(x, y);
+    }
+  }
+
+  return index;
+}
+
+#endif
@@ -2,21 +2,25 @@
 
 // STL
 #include <cassert>
+#include <cmath>
 #include <optional>
 
 // glm
+#include "glm/common.hpp"
+#include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 #include "glm/geometric.hpp"
 
 // src
 #include "Ray.h"
 #include "IRayTraceable.h"
+#include "Sampling.h"
 
 // Forward declarations
 class Ray;
 
-Sphere::Sphere(const glm::vec3& center, float radius)
-    : center_{center}, radius_{radius} {
+Sphere::Sphere(const glm::vec3& center, float radius, const Material& material)
+    : center_{center}, radius_{radius}, material_{material} {
   assert(radius_ > 0.0F && "Sphere radius must be positive");
 }
 
@@ -57,13 +61,34 @@ std::optional<TraceResult> Sphere::TraceRay(
   }
 
   // Root is within range, record and return trace result
+  return ResolveTraceResult(ray, center_, radius_, material_, root);
+}
+
+TraceResult Sphere::ResolveTraceResult(
+    const Ray& ray,
+    const glm::vec3& center,
+    float radius,
+    const Material& material,
+    float distance) {
   TraceResult trace_result{};
-  trace_result.distance = root;
+  trace_result.distance = distance;
+  trace_result.material = material;
   trace_result.impact_position = ray.At(trace_result.distance);
-  trace_result.impact_normal = (trace_result.impact_position - center_) / radius_;
+  trace_result.impact_normal = (trace_result.impact_position - center) / radius;
   trace_result.is_front_face =
     glm::dot(ray.direction(), trace_result.impact_normal) < 0.0F;
 
+  // Map textures by latitude and longitude; across the texture, v spans
+  // half a great circle
+  if (material.albedo_texture != kNoTexture) {
+    const glm::vec3& outward_normal{ trace_result.impact_normal };
+    trace_result.texture_coordinates = glm::vec2{
+      0.5F + std::atan2(outward_normal.z, outward_normal.x) / (2.0F * kPi),
+      std::acos(glm::clamp(outward_normal.y, -1.0F, 1.0F)) / kPi
+    };
+    trace_result.texture_scale = 1.0F / (kPi * radius);
+  }
+
   // Flip the normal if the collision occurred from within the sphere
   if (!trace_result.is_front_face) {
     trace_result.impact_normal = -trace_result.impact_normal;
@@ -16,7 +16,7 @@ class Ray;
 class Sphere final : public IRayTraceable {
 public:
   Sphere() = delete;
-  Sphere(const glm::vec3& center, float radius);
+  Sphere(const glm::vec3& center, float radius, const Material& material = {});
 
   [[nodiscard]]
   constexpr const glm::vec3& center() const noexcept {
@@ -28,15 +28,31 @@ public:
     return radius_;
   }
 
+  [[nodiscard]]
+  constexpr const Material& material() const noexcept {
+    return material_;
+  }
+
   [[nodiscard]]
   std::optional<TraceResult> TraceRay(
     const Ray& ray,
     float min_distance,
     float max_distance) const override;
 
+  // Builds the trace result for a ray known to hit a sphere at distance;
+  // shared with the packed sphere path in Scene
+  [[nodiscard]]
+  static TraceResult ResolveTraceResult(
+    const Ray& ray,
+    const glm::vec3& center,
+    float radius,
+    const Material& material,
+    float distance);
+
 private:
   glm::vec3 center_;
   float radius_;
+  Material material_;
 };
 
 #endif
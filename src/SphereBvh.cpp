@@ -0,0 +1,205 @@
+#include "SphereBvh.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+// glm
+#include "glm/vec3.hpp"
+#include "glm/common.hpp"
+
+// src
+#include "JobSystem.h"
+#include "Kernels.h"
+
+namespace {
+
+// Subtrees with at least this many spheres are built as separate jobs
+constexpr std::uint32_t kParallelThreshold{ 16384U };
+
+// Parent of the root node
+constexpr std::uint32_t kNoParent{ std::numeric_limits<std::uint32_t>::max() };
+
+}  // namespace
+
+struct SphereBvh::BuildState {
+  const SphereArrays& spheres;
+  JobSystem* jobs;
+  std::atomic<float>* progress;
+  std::vector<std::uint32_t>& order;
+  std::atomic<std::uint32_t> node_count;
+  std::atomic<std::uint32_t> spheres_done;
+};
+
+void SphereBvh::Build(
+    const SphereArrays& spheres,
+    JobSystem* jobs,
+    std::atomic<float>* progress,
+    std::vector<std::uint32_t>& order) {
+  nodes_.clear();
+  parents_.clear();
+  sphere_leaves_.clear();
+  order.resize(spheres.count);
+  std::iota(order.begin(), order.end(), 0U);
+  if (spheres.count == 0U) {
+    return;
+  }
+
+  // A binary tree with at least one sphere per leaf has at most
+  // 2N - 1 nodes; children are allocated from this pool in pairs
+  nodes_.resize(2U * spheres.count - 1U);
+  BuildState state{ spheres, jobs, progress, order, 1U, 0U };
+  BuildNode(state, 0U, 0U, static_cast<std::uint32_t>(spheres.count));
+  nodes_.resize(state.node_count.load());
+  nodes_.shrink_to_fit();
+
+  if (progress) {
+    progress->store(1.0F, std::memory_order_relaxed);
+  }
+}
+
+void SphereBvh::BuildNode(
+    BuildState& state,
+    std::uint32_t node_index,
+    std::uint32_t begin,
+    std::uint32_t end) {
+  const SphereArrays& spheres{ state.spheres };
+  const auto center_of = [&spheres](std::uint32_t sphere) {
+    return glm::vec3{
+      spheres.center_x[sphere], spheres.center_y[sphere], spheres.center_z[sphere]
+    };
+  };
+
+  // Compute bounds of the spheres and of their centers
+  BvhNode& node{ nodes_[node_index] };
+  const glm::vec3 first_center{ center_of(state.order[begin]) };
+  glm::vec3 centroid_min{ first_center };
+  glm::vec3 centroid_max{ first_center };
+  node.bounds_min = first_center;
+  node.bounds_max = first_center;
+  for (std::uint32_t i{ begin }; i < end; ++i) {
+    const std::uint32_t sphere{ state.order[i] };
+    const glm::vec3 center{ center_of(sphere) };
+    const glm::vec3 radius{ spheres.radius[sphere] };
+    node.bounds_min = glm::min(node.bounds_min, center - radius);
+    node.bounds_max = glm::max(node.bounds_max, center + radius);
+    centroid_min = glm::min(centroid_min, center);
+    centroid_max = glm::max(centroid_max, center);
+  }
+
+  // Small ranges become leaves
+  const std::uint32_t count{ end - begin };
+  if (count <= kLeafSize) {
+    node.first = begin;
+    node.count = count;
+
+    if (state.progress) {
+      const std::uint32_t spheres_done{ state.spheres_done.fetch_add(count) + count };
+      state.progress->store(static_cast<float>(spheres_done)
+                            / static_cast<float>(spheres.count),
+                            std::memory_order_relaxed);
+    }
+    return;
+  }
+
+  // Split at the median along the widest axis of the centers
+  const glm::vec3 centroid_extent{ centroid_max - centroid_min };
+  std::size_t axis{ 0U };
+  if (centroid_extent.y > centroid_extent[axis]) { axis = 1U; }
+  if (centroid_extent.z > centroid_extent[axis]) { axis = 2U; }
+  const float* axis_centers{
+    axis == 0U ? spheres.center_x : (axis == 1U ? spheres.center_y : spheres.center_z)
+  };
+
+  const std::uint32_t middle{ begin + count / 2U };
+  std::nth_element(state.order.begin() + begin,
+                   state.order.begin() + middle,
+                   state.order.begin() + end,
+                   [axis_centers](std::uint32_t a, std::uint32_t b) {
+                     return axis_centers[a] < axis_centers[b];
+                   });
+
+  const std::uint32_t left_child{ state.node_count.fetch_add(2U) };
+  node.first = left_child;
+  node.count = 0U;
+
+  // Build large subtrees in parallel; the left half goes to the pool
+  // while this thread continues with the right half
+  if (state.jobs && count >= kParallelThreshold) {
+    JobGroup group{};
+    state.jobs->Submit(group, [this, &state, left_child, begin, middle]() {
+      BuildNode(state, left_child, begin, middle);
+    });
+    BuildNode(state, left_child + 1U, middle, end);
+    state.jobs->Wait(group);
+  } else {
+    BuildNode(state, left_child, begin, middle);
+    BuildNode(state, left_child + 1U, middle, end);
+  }
+}
+
+void SphereBvh::Refit(
+    const SphereArrays& spheres,
+    const std::vector<std::uint32_t>& changed_spheres) {
+  if (nodes_.empty() || changed_spheres.empty()) {
+    return;
+  }
+  if (parents_.empty()) {
+    BuildRefitLinks(spheres.count);
+  }
+
+  // Recompute each affected leaf from its spheres, then walk towards the
+  // root until a node's bounds come out unchanged
+  std::vector<std::uint32_t> leaves{};
+  leaves.reserve(changed_spheres.size());
+  for (const std::uint32_t sphere : changed_spheres) {
+    leaves.emplace_back(sphere_leaves_[sphere]);
+  }
+  std::ranges::sort(leaves);
+  const auto [unique_end, leaves_end] = std::ranges::unique(leaves);
+  leaves.erase(unique_end, leaves_end);
+
+  for (const std::uint32_t leaf : leaves) {
+    BvhNode& leaf_node{ nodes_[leaf] };
+    leaf_node.bounds_min = glm::vec3{ std::numeric_limits<float>::infinity() };
+    leaf_node.bounds_max = glm::vec3{ -std::numeric_limits<float>::infinity() };
+    for (std::uint32_t i{ leaf_node.first }; i < leaf_node.first + leaf_node.count; ++i) {
+      const glm::vec3 center{ spheres.center_x[i], spheres.center_y[i], spheres.center_z[i] };
+      const glm::vec3 radius{ spheres.radius[i] };
+      leaf_node.bounds_min = glm::min(leaf_node.bounds_min, center - radius);
+      leaf_node.bounds_max = glm::max(leaf_node.bounds_max, center + radius);
+    }
+
+    for (std::uint32_t node{ parents_[leaf] }; node != kNoParent; node = parents_[node]) {
+      BvhNode& parent{ nodes_[node] };
+      const BvhNode& left{ nodes_[parent.first] };
+      const BvhNode& right{ nodes_[parent.first + 1U] };
+      const glm::vec3 bounds_min{ glm::min(left.bounds_min, right.bounds_min) };
+      const glm::vec3 bounds_max{ glm::max(left.bounds_max, right.bounds_max) };
+      if (bounds_min == parent.bounds_min && bounds_max == parent.bounds_max) {
+        break;
+      }
+      parent.bounds_min = bounds_min;
+      parent.bounds_max = bounds_max;
+    }
+  }
+}
+
+void SphereBvh::BuildRefitLinks(std::size_t sphere_count) {
+  parents_.assign(nodes_.size(), kNoParent);
+  sphere_leaves_.assign(sphere_count, 0U);
+  for (std::uint32_t node{ 0U }; node < nodes_.size(); ++node) {
+    const BvhNode& bvh_node{ nodes_[node] };
+    if (bvh_node.count > 0U) {
+      std::fill_n(sphere_leaves_.begin() + bvh_node.first, bvh_node.count, node);
+    } else {
+      parents_[bvh_node.first] = node;
+      parents_[bvh_node.first + 1U] = node;
+    }
+  }
+}
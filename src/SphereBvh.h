@@ -0,0 +1,85 @@
+#ifndef SPHEREBVH_H
+#define SPHEREBVH_H
+
+// STL
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// glm
+#include "glm/vec3.hpp"
+
+// src
+#include "Kernels.h"
+
+// Forward declarations
+class JobSystem;
+
+struct BvhNode {
+  glm::vec3 bounds_min;
+  // Index of the left child (the right one follows it) for interior
+  // nodes, or of the first sphere for leaves
+  std::uint32_t first;
+  glm::vec3 bounds_max;
+  // Number of spheres in a leaf; zero for interior nodes
+  std::uint32_t count;
+};
+
+// Bounding volume hierarchy over packed spheres.
+//
+// Leaves reference contiguous ranges of spheres, so the build returns the
+// order the caller must rearrange its sphere arrays into; each leaf can
+// then be handed to the intersection kernel as a plain SphereArrays view.
+class SphereBvh {
+public:
+  static constexpr std::uint32_t kLeafSize{ 8U };
+
+  SphereBvh() = default;
+
+  // Builds the hierarchy, splitting large subtrees across jobs if given.
+  // order receives, for each position in the new layout, the index of the
+  // sphere in the input. progress, if given, is advanced from 0 to 1.
+  void Build(
+    const SphereArrays& spheres,
+    JobSystem* jobs,
+    std::atomic<float>* progress,
+    std::vector<std::uint32_t>& order);
+
+  // Updates the bounds of the leaves holding the given spheres and of
+  // their ancestors after those spheres moved or changed size, keeping
+  // the tree's structure. Tracing stays correct, but large moves leave a
+  // looser tree than a rebuild would.
+  void Refit(
+    const SphereArrays& spheres,
+    const std::vector<std::uint32_t>& changed_spheres);
+
+  [[nodiscard]]
+  const std::vector<BvhNode>& nodes() const noexcept {
+    return nodes_;
+  }
+
+  [[nodiscard]]
+  bool empty() const noexcept {
+    return nodes_.empty();
+  }
+
+private:
+  struct BuildState;
+
+  void BuildNode(
+    BuildState& state,
+    std::uint32_t node_index,
+    std::uint32_t begin,
+    std::uint32_t end);
+
+  // Fills parents_ and sphere_leaves_, which only refitting needs
+  void BuildRefitLinks(std::size_t sphere_count);
+
+private:
+  std::vector<BvhNode> nodes_;
+  std::vector<std::uint32_t> parents_;
+  std::vector<std::uint32_t> sphere_leaves_;
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include "TextureCache.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+// glm
+#include "glm/vec3.hpp"
+#include "glm/common.hpp"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// src
+#include "TiledTexture.h"
+
+namespace {
+
+// Wraps a possibly negative texel coordinate into [0, size)
+std::uint32_t WrapTexel(std::int64_t coordinate, std::uint32_t size) {
+  const std::int64_t wrapped{ coordinate % static_cast<std::int64_t>(size) };
+  return static_cast<std::uint32_t>(wrapped < 0 ? wrapped + size : wrapped);
+}
+
+}  // namespace
+
+std::size_t TextureCache::TileKeyHash::operator()(
+    const TileKey& key) const noexcept {
+  // Mix the fields so neighbouring tiles land in different shards
+  std::uint64_t hash{ key.texture };
+  hash = hash * 0x9E3779B97F4A7C15ULL + key.level;
+  hash = hash * 0x9E3779B97F4A7C15ULL + key.tile_x;
+  hash = hash * 0x9E3779B97F4A7C15ULL + key.tile_y;
+  hash ^= hash >> 29U;
+  return static_cast<std::size_t>(hash);
+}
+
+TextureCache::TextureCache(std::size_t capacity_bytes)
+    : shard_capacity_bytes_{ capacity_bytes / kShardCount }
+    , hits_{ 0U }
+    , misses_{ 0U }
+    , evictions_{ 0U } {}
+
+std::optional<TextureId> TextureCache::Open(const std::filesystem::path& path) {
+  std::unique_ptr<TiledTextureFile> texture{ TiledTextureFile::Open(path) };
+  if (!texture) {
+    return std::nullopt;
+  }
+
+  // Warn if a single tile would not fit in a shard, as every lookup
+  // would then miss
+  if (texture->tile_bytes() > shard_capacity_bytes_) {
+    spdlog::warn("Texture cache shard capacity is smaller than one tile of {}.",
+                 path.string());
+  }
+
+  textures_.emplace_back(std::move(texture));
+  const TextureId id{ static_cast<TextureId>(textures_.size() - 1U) };
+  TouchFile(id);
+  return id;
+}
+
+glm::vec3 TextureCache::Sample(
+    TextureId texture,
+    float u,
+    float v,
+    float footprint) const {
+  const TiledTextureFile& texture_file{ *textures_[texture] };
+  const TiledTextureLevel& base_level{ texture_file.level(0U) };
+
+  // Select the mip level whose texel size matches the ray footprint
+  const float footprint_texels{
+    footprint * static_cast<float>(std::max(base_level.width, base_level.height))
+  };
+  const float max_level{ static_cast<float>(texture_file.level_count() - 1U) };
+  const float level{
+    glm::clamp(footprint_texels > 1.0F ? std::log2(footprint_texels) : 0.0F,
+               0.0F, max_level)
+  };
+
+  // Blend between the two nearest levels
+  const std::uint32_t fine_level{ static_cast<std::uint32_t>(level) };
+  const float blend{ level - static_cast<float>(fine_level) };
+  const glm::vec3 fine_color{ SampleBilinear(texture, fine_level, u, v) };
+  if (blend <= 0.0F) {
+    return fine_color;
+  }
+
+  const glm::vec3 coarse_color{ SampleBilinear(texture, fine_level + 1U, u, v) };
+  return glm::mix(fine_color, coarse_color, blend);
+}
+
+TextureCacheStats TextureCache::GetStats() const noexcept {
+  TextureCacheStats stats{};
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  stats.capacity_bytes = shard_capacity_bytes_ * kShardCount;
+  for (Shard& shard : shards_) {
+    const std::scoped_lock lock{ shard.mutex };
+    stats.resident_bytes += shard.resident_bytes;
+  }
+
+  return stats;
+}
+
+void TextureCache::LogStats() const {
+  const TextureCacheStats stats{ GetStats() };
+  const std::uint64_t lookups{ stats.hits + stats.misses };
+  const double hit_rate{
+    lookups > 0U ? 100.0 * static_cast<double>(stats.hits) / static_cast<double>(lookups)
+                 : 0.0
+  };
+  spdlog::info("Texture cache: {} hits, {} misses ({:.2f}% hit rate), "
+               "{} evictions, {}/{} KiB resident.",
+               stats.hits, stats.misses, hit_rate, stats.evictions,
+               stats.resident_bytes / 1024U, stats.capacity_bytes / 1024U);
+}
+
+std::shared_ptr<const TextureCache::Tile> TextureCache::GetTile(
+    const TileKey& key) const {
+  Shard& shard{ shards_[TileKeyHash{}(key) % kShardCount] };
+
+  // Fast path: tile is resident, mark it most recently used.
+  // Otherwise, publish the pending read so other threads missing the same
+  // tile wait for it instead of reading it again.
+  std::promise<std::shared_ptr<const Tile>> promise{};
+  TileFuture tile_future{};
+  bool needs_read{ false };
+  {
+    const std::scoped_lock lock{ shard.mutex };
+    if (const auto entry{ shard.entries.find(key) }; entry != shard.entries.end()) {
+      shard.lru.splice(shard.lru.begin(), shard.lru, entry->second);
+      hits_.fetch_add(1U, std::memory_order_relaxed);
+      return entry->second->second;
+    }
+    if (shard.failed.contains(key)) {
+      return nullptr;
+    }
+    if (const auto load{ shard.loading.find(key) }; load != shard.loading.end()) {
+      tile_future = load->second;
+    } else {
+      tile_future = promise.get_future().share();
+      shard.loading.emplace(key, tile_future);
+      needs_read = true;
+    }
+  }
+  misses_.fetch_add(1U, std::memory_order_relaxed);
+
+  // The reading thread only waits on the disk, so waiting on it is safe
+  // even from a pool job
+  if (!needs_read) {
+    return tile_future.get();
+  }
+
+  // Load the tile without holding the shard lock so other threads can
+  // keep hitting the shard while this one waits on the disk
+  std::shared_ptr<Tile> tile{ std::make_shared<Tile>() };
+  if (!textures_[key.texture]->ReadTile(key.level, key.tile_x, key.tile_y, *tile)) {
+    spdlog::error("Failed to read tile ({}, {}) of level {} of texture {}.",
+                  key.tile_x, key.tile_y, key.level, key.texture);
+    tile.reset();
+  } else {
+    TouchFile(key.texture);
+  }
+
+  const std::scoped_lock lock{ shard.mutex };
+  shard.loading.erase(key);
+  promise.set_value(tile);
+  if (!tile) {
+    shard.failed.insert(key);
+    return nullptr;
+  }
+
+  // Insert tile and evict least recently used tiles until within budget;
+  // evicted tiles still referenced by a sampling thread are freed once
+  // that thread releases them
+  shard.lru.emplace_front(key, tile);
+  shard.entries.emplace(key, shard.lru.begin());
+  shard.resident_bytes += tile->size();
+  while (shard.resident_bytes > shard_capacity_bytes_ && shard.lru.size() > 1U) {
+    const auto& [evicted_key, evicted_tile] = shard.lru.back();
+    shard.resident_bytes -= evicted_tile->size();
+    shard.entries.erase(evicted_key);
+    shard.lru.pop_back();
+    evictions_.fetch_add(1U, std::memory_order_relaxed);
+  }
+
+  return tile;
+}
+
+void TextureCache::TouchFile(TextureId texture) const {
+  const std::scoped_lock lock{ open_files_mutex_ };
+  if (const auto entry{ open_file_entries_.find(texture) };
+      entry != open_file_entries_.end()) {
+    open_files_.splice(open_files_.begin(), open_files_, entry->second);
+    return;
+  }
+
+  open_files_.emplace_front(texture);
+  open_file_entries_.emplace(texture, open_files_.begin());
+  while (open_files_.size() > kMaxOpenFiles) {
+    const TextureId closed_texture{ open_files_.back() };
+    textures_[closed_texture]->CloseFile();
+    open_file_entries_.erase(closed_texture);
+    open_files_.pop_back();
+  }
+}
+
+glm::vec3 TextureCache::SampleBilinear(
+    TextureId texture,
+    std::uint32_t level,
+    float u,
+    float v) const {
+  const TiledTextureFile& texture_file{ *textures_[texture] };
+  const TiledTextureLevel& texture_level{ texture_file.level(level) };
+  const std::uint32_t tile_size{ texture_file.tile_size() };
+
+  // Convert to texel space, centering texels on integer coordinates
+  const float x{ (u - std::floor(u)) * static_cast<float>(texture_level.width) - 0.5F };
+  const float y{ (v - std::floor(v)) * static_cast<float>(texture_level.height) - 0.5F };
+  const float x_floor{ std::floor(x) };
+  const float y_floor{ std::floor(y) };
+  const float tx{ x - x_floor };
+  const float ty{ y - y_floor };
+
+  // The four texels usually share a tile, so remember the last one
+  TileKey cached_key{ texture, level, 0U, 0U };
+  std::shared_ptr<const Tile> cached_tile{};
+  bool has_cached_tile{ false };
+
+  const auto fetch_texel = [&](std::int64_t texel_x, std::int64_t texel_y) {
+    const std::uint32_t wrapped_x{ WrapTexel(texel_x, texture_level.width) };
+    const std::uint32_t wrapped_y{ WrapTexel(texel_y, texture_level.height) };
+    const TileKey key{ texture, level, wrapped_x / tile_size, wrapped_y / tile_size };
+    if (!has_cached_tile || !(key == cached_key)) {
+      cached_key = key;
+      cached_tile = GetTile(key);
+      has_cached_tile = true;
+    }
+    if (!cached_tile) {
+      return glm::vec3{ 0.0F, 0.0F, 0.0F };
+    }
+
+    const std::size_t offset{
+      (static_cast<std::size_t>(wrapped_y % tile_size) * tile_size
+       + wrapped_x % tile_size) * TiledTextureFile::kChannels
+    };
+    constexpr float inverse_max{ 1.0F / 255.0F };
+    return glm::vec3{
+      static_cast<float>((*cached_tile)[offset + 0U]) * inverse_max,
+      static_cast<float>((*cached_tile)[offset + 1U]) * inverse_max,
+      static_cast<float>((*cached_tile)[offset + 2U]) * inverse_max
+    };
+  };
+
+  const std::int64_t x0{ static_cast<std::int64_t>(x_floor) };
+  const std::int64_t y0{ static_cast<std::int64_t>(y_floor) };
+  const glm::vec3 top{ glm::mix(fetch_texel(x0, y0), fetch_texel(x0 + 1, y0), tx) };
+  const glm::vec3 bottom{ glm::mix(fetch_texel(x0, y0 + 1), fetch_texel(x0 + 1, y0 + 1), tx) };
+  return glm::mix(top, bottom, ty);
+}
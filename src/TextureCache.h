@@ -0,0 +1,134 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+// STL
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// glm
+#include "glm/vec3.hpp"
+
+// src
+#include "IRayTraceable.h"
+#include "TiledTexture.h"
+
+struct TextureCacheStats {
+  std::uint64_t hits;
+  std::uint64_t misses;
+  std::uint64_t evictions;
+  std::size_t resident_bytes;
+  std::size_t capacity_bytes;
+};
+
+// Memory-bounded cache of texture tiles shared by all render threads.
+//
+// Tiles are loaded lazily from tiled texture files into a fixed number of
+// independently locked LRU shards, so concurrent lookups rarely contend
+// and resident memory never exceeds the configured capacity, regardless
+// of how many textures are open. Only the files of the most recently read
+// textures keep a handle open; the others are reopened on their next
+// miss.
+class TextureCache {
+public:
+  static constexpr std::size_t kDefaultCapacityBytes{ 256U * 1024U * 1024U };
+
+  TextureCache() = delete;
+  explicit TextureCache(std::size_t capacity_bytes);
+
+  TextureCache(const TextureCache&) = delete;
+  TextureCache& operator=(const TextureCache&) = delete;
+
+  // Opens a tiled texture; not safe to call concurrently with Sample
+  [[nodiscard]]
+  std::optional<TextureId> Open(const std::filesystem::path& path);
+
+  // Trilinearly filters a texture at (u, v) with repeat wrapping.
+  // footprint is the width in texture space (0 to 1 across the texture)
+  // covered by the ray at the shading point, and selects the mip level.
+  [[nodiscard]]
+  glm::vec3 Sample(TextureId texture, float u, float v, float footprint) const;
+
+  [[nodiscard]]
+  TextureCacheStats GetStats() const noexcept;
+
+  void LogStats() const;
+
+private:
+  struct TileKey {
+    TextureId texture;
+    std::uint32_t level;
+    std::uint32_t tile_x;
+    std::uint32_t tile_y;
+
+    bool operator==(const TileKey&) const = default;
+  };
+
+  struct TileKeyHash {
+    std::size_t operator()(const TileKey& key) const noexcept;
+  };
+
+  using Tile = std::vector<std::uint8_t>;
+  using LruList = std::list<std::pair<TileKey, std::shared_ptr<const Tile>>>;
+
+  using TileFuture = std::shared_future<std::shared_ptr<const Tile>>;
+
+  struct Shard {
+    std::mutex mutex;
+    LruList lru;
+    std::unordered_map<TileKey, LruList::iterator, TileKeyHash> entries;
+    // Tiles being read, so threads missing the same one share a read
+    std::unordered_map<TileKey, TileFuture, TileKeyHash> loading;
+    // Tiles that failed to read, so they are reported once rather than
+    // read again by every texel fetch
+    std::unordered_set<TileKey, TileKeyHash> failed;
+    std::size_t resident_bytes{ 0U };
+  };
+
+  static constexpr std::size_t kShardCount{ 16U };
+  static constexpr std::size_t kMaxOpenFiles{ 64U };
+
+  // Returns the requested tile, loading it from disk on a miss, or null
+  // if it cannot be read
+  [[nodiscard]]
+  std::shared_ptr<const Tile> GetTile(const TileKey& key) const;
+
+  // Marks the texture's file most recently read, closing the least
+  // recently read files beyond kMaxOpenFiles
+  void TouchFile(TextureId texture) const;
+
+  [[nodiscard]]
+  glm::vec3 SampleBilinear(
+    TextureId texture,
+    std::uint32_t level,
+    float u,
+    float v) const;
+
+private:
+  std::vector<std::unique_ptr<TiledTextureFile>> textures_;
+
+  mutable std::array<Shard, kShardCount> shards_;
+  std::size_t shard_capacity_bytes_;
+
+  // Textures whose file is open, most recently read first
+  mutable std::mutex open_files_mutex_;
+  mutable std::list<TextureId> open_files_;
+  mutable std::unordered_map<TextureId, std::list<TextureId>::iterator> open_file_entries_;
+
+  mutable std::atomic<std::uint64_t> hits_;
+  mutable std::atomic<std::uint64_t> misses_;
+  mutable std::atomic<std::uint64_t> evictions_;
+};
+
+#endif
@@ -0,0 +1,292 @@
+#include "TiledTexture.h"
+
+// STL
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// src
+#include "PositionalFile.h"
+
+namespace {
+
+struct TiledTextureHeader {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t width;
+  std::uint32_t height;
+  std::uint32_t tile_size;
+  std::uint32_t level_count;
+};
+
+std::vector<TiledTextureLevel> ComputeLevels(
+    std::uint32_t width,
+    std::uint32_t height,
+    std::uint32_t tile_size) {
+  std::vector<TiledTextureLevel> levels{};
+  std::uint64_t first_tile{ 0U };
+  while (true) {
+    TiledTextureLevel level{};
+    level.width = width;
+    level.height = height;
+    level.tiles_x = (width + tile_size - 1U) / tile_size;
+    level.tiles_y = (height + tile_size - 1U) / tile_size;
+    level.first_tile = first_tile;
+    levels.emplace_back(level);
+
+    first_tile += static_cast<std::uint64_t>(level.tiles_x) * level.tiles_y;
+    if (width == 1U && height == 1U) {
+      break;
+    }
+    width = std::max(width / 2U, 1U);
+    height = std::max(height / 2U, 1U);
+  }
+
+  return levels;
+}
+
+// Box filters a level down to the next, clamping at odd edges
+std::vector<std::uint8_t> Downsample(
+    const std::vector<std::uint8_t>& source,
+    const TiledTextureLevel& source_level,
+    const TiledTextureLevel& target_level) {
+  constexpr std::uint32_t channels{ TiledTextureFile::kChannels };
+  std::vector<std::uint8_t> target(
+    static_cast<std::size_t>(target_level.width) * target_level.height * channels
+  );
+
+  for (std::uint32_t y{ 0U }; y < target_level.height; ++y) {
+    const std::uint32_t y0{ std::min(2U * y, source_level.height - 1U) };
+    const std::uint32_t y1{ std::min(2U * y + 1U, source_level.height - 1U) };
+    for (std::uint32_t x{ 0U }; x < target_level.width; ++x) {
+      const std::uint32_t x0{ std::min(2U * x, source_level.width - 1U) };
+      const std::uint32_t x1{ std::min(2U * x + 1U, source_level.width - 1U) };
+      for (std::uint32_t c{ 0U }; c < channels; ++c) {
+        const auto at = [&](std::uint32_t sx, std::uint32_t sy) {
+          return static_cast<std::uint32_t>(
+            source[(static_cast<std::size_t>(sy) * source_level.width + sx)
+                   * channels + c]
+          );
+        };
+        const std::uint32_t sum{ at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1) };
+        target[(static_cast<std::size_t>(y) * target_level.width + x) * channels + c] =
+          static_cast<std::uint8_t>((sum + 2U) / 4U);
+      }
+    }
+  }
+
+  return target;
+}
+
+}  // namespace
+
+TiledTextureFile::TiledTextureFile(
+    const std::filesystem::path& path,
+    std::shared_ptr<const PositionalFile> file,
+    std::uint32_t width,
+    std::uint32_t height,
+    std::uint32_t tile_size)
+    : path_{ path }
+    , file_{ std::move(file) }
+    , tile_size_{ tile_size }
+    , data_offset_{ sizeof(TiledTextureHeader) }
+    , levels_{ ComputeLevels(width, height, tile_size) } {}
+
+std::unique_ptr<TiledTextureFile> TiledTextureFile::Open(
+    const std::filesystem::path& path) {
+  std::shared_ptr<const PositionalFile> file{ PositionalFile::Open(path) };
+  if (!file) {
+    spdlog::error("Failed to open texture {}.", path.string());
+    return nullptr;
+  }
+
+  // Validate header
+  TiledTextureHeader header{};
+  if (!file->Read(0U, &header, sizeof(header))
+      || header.magic != kMagic
+      || header.version != kVersion
+      || header.width == 0U || header.height == 0U
+      || header.tile_size == 0U) {
+    spdlog::error("Texture {} is not a valid tiled texture.", path.string());
+    return nullptr;
+  }
+
+  std::unique_ptr<TiledTextureFile> texture{
+    new TiledTextureFile{
+      path, std::move(file), header.width, header.height, header.tile_size
+    }
+  };
+  if (texture->level_count() != header.level_count) {
+    spdlog::error("Texture {} has an inconsistent mip chain.", path.string());
+    return nullptr;
+  }
+
+  return texture;
+}
+
+bool TiledTextureFile::Write(
+    const std::filesystem::path& path,
+    std::uint32_t width,
+    std::uint32_t height,
+    const std::vector<std::uint8_t>& rgb,
+    std::uint32_t tile_size) {
+  if (rgb.size() != static_cast<std::size_t>(width) * height * kChannels) {
+    spdlog::error("Texture data does not match its dimensions.");
+    return false;
+  }
+
+  std::ofstream output_file{ path, std::ios::binary };
+  if (!output_file) {
+    spdlog::error("Failed to open texture {} for writing.", path.string());
+    return false;
+  }
+
+  const std::vector<TiledTextureLevel> levels{
+    ComputeLevels(width, height, tile_size)
+  };
+
+  // Write header
+  const TiledTextureHeader header{
+    kMagic, kVersion, width, height, tile_size,
+    static_cast<std::uint32_t>(levels.size())
+  };
+  output_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  // Write every level tile by tile, generating the next level from the
+  // current one so only two levels are held in memory at once
+  std::vector<std::uint8_t> level_rgb{ rgb };
+  std::vector<std::uint8_t> tile(
+    static_cast<std::size_t>(tile_size) * tile_size * kChannels
+  );
+  for (std::size_t level_index{ 0U }; level_index < levels.size(); ++level_index) {
+    const TiledTextureLevel& level{ levels[level_index] };
+    for (std::uint32_t tile_y{ 0U }; tile_y < level.tiles_y; ++tile_y) {
+      for (std::uint32_t tile_x{ 0U }; tile_x < level.tiles_x; ++tile_x) {
+        // Copy texels, replicating the edge into the padding
+        for (std::uint32_t y{ 0U }; y < tile_size; ++y) {
+          const std::uint32_t source_y{
+            std::min(tile_y * tile_size + y, level.height - 1U)
+          };
+          for (std::uint32_t x{ 0U }; x < tile_size; ++x) {
+            const std::uint32_t source_x{
+              std::min(tile_x * tile_size + x, level.width - 1U)
+            };
+            const std::size_t source_offset{
+              (static_cast<std::size_t>(source_y) * level.width + source_x) * kChannels
+            };
+            const std::size_t tile_offset{
+              (static_cast<std::size_t>(y) * tile_size + x) * kChannels
+            };
+            std::copy_n(level_rgb.begin() + static_cast<std::ptrdiff_t>(source_offset),
+                        kChannels,
+                        tile.begin() + static_cast<std::ptrdiff_t>(tile_offset));
+          }
+        }
+        output_file.write(reinterpret_cast<const char*>(tile.data()),
+                          static_cast<std::streamsize>(tile.size()));
+      }
+    }
+
+    if (level_index + 1U < levels.size()) {
+      level_rgb = Downsample(level_rgb, level, levels[level_index + 1U]);
+    }
+  }
+
+  if (!output_file) {
+    spdlog::error("Failed to write texture {}.", path.string());
+    return false;
+  }
+
+  spdlog::info("Wrote {}x{} texture {} with {} mip levels.",
+               width, height, path.string(), levels.size());
+  return true;
+}
+
+bool TiledTextureFile::ReadTile(
+    std::uint32_t level,
+    std::uint32_t tile_x,
+    std::uint32_t tile_y,
+    std::vector<std::uint8_t>& output) const {
+  const TiledTextureLevel& texture_level{ levels_[level] };
+  const std::uint64_t tile_index{
+    texture_level.first_tile
+    + static_cast<std::uint64_t>(tile_y) * texture_level.tiles_x
+    + tile_x
+  };
+  const std::uint64_t offset{ data_offset_ + tile_index * tile_bytes() };
+
+  output.resize(tile_bytes());
+
+  // Positional reads need no lock, so threads missing different tiles
+  // read them in parallel
+  const std::shared_ptr<const PositionalFile> file{ AcquireFile() };
+  return file && file->Read(offset, output.data(), output.size());
+}
+
+void TiledTextureFile::CloseFile() const {
+  const std::scoped_lock lock{ file_mutex_ };
+  file_.reset();
+}
+
+std::shared_ptr<const PositionalFile> TiledTextureFile::AcquireFile() const {
+  const std::scoped_lock lock{ file_mutex_ };
+  if (!file_) {
+    file_ = PositionalFile::Open(path_);
+    if (!file_) {
+      spdlog::error("Failed to reopen texture {}.", path_.string());
+    }
+  }
+  return file_;
+}
+
+std::optional<std::vector<std::uint8_t>> LoadPpm(
+    const std::filesystem::path& path,
+    std::uint32_t& width,
+    std::uint32_t& height) {
+  std::ifstream input_file{ path, std::ios::binary };
+  if (!input_file) {
+    spdlog::error("Failed to open image {}.", path.string());
+    return std::nullopt;
+  }
+
+  // Read header
+  std::string format{};
+  std::uint32_t max_value{};
+  input_file >> format >> width >> height >> max_value;
+  if (!input_file || (format != "P3" && format != "P6")
+      || width == 0U || height == 0U || max_value != 255U) {
+    spdlog::error("Image {} is not an 8-bit PPM.", path.string());
+    return std::nullopt;
+  }
+
+  // Read pixels
+  std::vector<std::uint8_t> rgb(static_cast<std::size_t>(width) * height * 3U);
+  if (format == "P6") {
+    input_file.get();
+    input_file.read(reinterpret_cast<char*>(rgb.data()),
+                    static_cast<std::streamsize>(rgb.size()));
+  } else {
+    for (std::uint8_t& value : rgb) {
+      int component{};
+      input_file >> component;
+      value = static_cast<std::uint8_t>(component);
+    }
+  }
+  if (!input_file) {
+    spdlog::error("Image {} is truncated.", path.string());
+    return std::nullopt;
+  }
+
+  return rgb;
+}
@@ -0,0 +1,116 @@
+#ifndef TILEDTEXTURE_H
+#define TILEDTEXTURE_H
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Forward declarations
+class PositionalFile;
+
+// On-disk tiled mip pyramid of an 8-bit RGB image.
+//
+// Layout: a fixed-size header followed by the tiles of every mip level,
+// finest level first, each level in row-major tile order. Every tile is
+// stored padded to tile_size x tile_size texels (edge texels replicated)
+// so the offset of any tile can be computed without a lookup table.
+struct TiledTextureLevel {
+  std::uint32_t width;
+  std::uint32_t height;
+  std::uint32_t tiles_x;
+  std::uint32_t tiles_y;
+  std::uint64_t first_tile;
+};
+
+class TiledTextureFile {
+public:
+  static constexpr std::uint32_t kMagic{ 0x58455452U };  // "RTEX"
+  static constexpr std::uint32_t kVersion{ 1U };
+  static constexpr std::uint32_t kChannels{ 3U };
+  static constexpr std::uint32_t kDefaultTileSize{ 64U };
+
+  TiledTextureFile() = delete;
+  TiledTextureFile(const TiledTextureFile&) = delete;
+  TiledTextureFile& operator=(const TiledTextureFile&) = delete;
+
+  // Opens a tiled texture and reads its header; tiles are read on demand
+  [[nodiscard]]
+  static std::unique_ptr<TiledTextureFile> Open(
+    const std::filesystem::path& path);
+
+  // Builds the mip pyramid of an RGB image and writes it tiled to disk
+  static bool Write(
+    const std::filesystem::path& path,
+    std::uint32_t width,
+    std::uint32_t height,
+    const std::vector<std::uint8_t>& rgb,
+    std::uint32_t tile_size = kDefaultTileSize);
+
+  // Reads one tile into output, reopening the file if it was closed;
+  // safe to call from multiple threads
+  bool ReadTile(
+    std::uint32_t level,
+    std::uint32_t tile_x,
+    std::uint32_t tile_y,
+    std::vector<std::uint8_t>& output) const;
+
+  // Releases the file handle, e.g. to bound how many files are open at
+  // once; reads in progress finish first
+  void CloseFile() const;
+
+  [[nodiscard]]
+  constexpr std::uint32_t tile_size() const noexcept {
+    return tile_size_;
+  }
+
+  [[nodiscard]]
+  constexpr std::size_t tile_bytes() const noexcept {
+    return static_cast<std::size_t>(tile_size_) * tile_size_ * kChannels;
+  }
+
+  [[nodiscard]]
+  std::uint32_t level_count() const noexcept {
+    return static_cast<std::uint32_t>(levels_.size());
+  }
+
+  [[nodiscard]]
+  const TiledTextureLevel& level(std::uint32_t index) const noexcept {
+    return levels_[index];
+  }
+
+private:
+  TiledTextureFile(
+    const std::filesystem::path& path,
+    std::shared_ptr<const PositionalFile> file,
+    std::uint32_t width,
+    std::uint32_t height,
+    std::uint32_t tile_size);
+
+  // Returns the open file, opening it again if it was closed
+  [[nodiscard]]
+  std::shared_ptr<const PositionalFile> AcquireFile() const;
+
+private:
+  std::filesystem::path path_;
+  // Only guards swapping the handle; reads go through a copy of it
+  mutable std::mutex file_mutex_;
+  mutable std::shared_ptr<const PositionalFile> file_;
+
+  std::uint32_t tile_size_;
+  std::uint64_t data_offset_;
+  std::vector<TiledTextureLevel> levels_;
+};
+
+// Reads a binary (P6) or ASCII (P3) PPM image as 8-bit RGB
+[[nodiscard]]
+std::optional<std::vector<std::uint8_t>> LoadPpm(
+  const std::filesystem::path& path,
+  std::uint32_t& width,
+  std::uint32_t& height);
+
+#endif
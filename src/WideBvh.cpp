@@ -0,0 +1,153 @@
+#include "WideBvh.h"
+
+// STL
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// src
+#include "SphereBvh.h"
+
+namespace {
+
+float SurfaceArea(const BvhNode& node) {
+  const float x{ node.bounds_max.x - node.bounds_min.x };
+  const float y{ node.bounds_max.y - node.bounds_min.y };
+  const float z{ node.bounds_max.z - node.bounds_min.z };
+  return x * y + y * z + z * x;
+}
+
+float ExponentToScale(std::uint32_t exponent) {
+  return std::bit_cast<float>(exponent << 23U);
+}
+
+// Quantizes the children's bounds along one axis, returning false if the
+// step is too small to reach the farthest child in 255 steps
+bool QuantizeAxis(
+    const std::vector<BvhNode>& binary_nodes,
+    const std::uint32_t* children,
+    std::size_t child_count,
+    std::size_t axis,
+    WideBvhNode& node) {
+  const float origin{ node.origin[axis] };
+  const float scale{ ExponentToScale(node.exponent[axis]) };
+  for (std::size_t i{ 0U }; i < child_count; ++i) {
+    const BvhNode& child{ binary_nodes[children[i]] };
+
+    // Round outwards, correcting for rounding in the decode
+    float low{ std::clamp(std::floor((child.bounds_min[axis] - origin) / scale), 0.0F, 255.0F) };
+    while (low > 0.0F && origin + low * scale > child.bounds_min[axis]) {
+      low -= 1.0F;
+    }
+    float high{ std::max(std::ceil((child.bounds_max[axis] - origin) / scale), low) };
+    while (high <= 255.0F && origin + high * scale < child.bounds_max[axis]) {
+      high += 1.0F;
+    }
+    if (high > 255.0F) {
+      return false;
+    }
+
+    node.child_min[axis][i] = static_cast<std::uint8_t>(low);
+    node.child_max[axis][i] = static_cast<std::uint8_t>(high);
+  }
+
+  return true;
+}
+
+void CollapseNode(
+    const std::vector<BvhNode>& binary_nodes,
+    std::uint32_t binary_index,
+    std::vector<WideBvhNode>& nodes,
+    std::uint32_t wide_index) {
+  // Gather up to kWidth children by repeatedly opening the interior
+  // child with the largest surface area
+  std::uint32_t children[WideBvhNode::kWidth]{};
+  std::size_t child_count{ 0U };
+  const BvhNode& binary_node{ binary_nodes[binary_index] };
+  if (binary_node.count > 0U) {
+    // A root leaf still needs a node to hold its bounds
+    children[child_count++] = binary_index;
+  } else {
+    children[child_count++] = binary_node.first;
+    children[child_count++] = binary_node.first + 1U;
+  }
+  while (child_count < WideBvhNode::kWidth) {
+    std::size_t largest{ child_count };
+    for (std::size_t i{ 0U }; i < child_count; ++i) {
+      if (binary_nodes[children[i]].count == 0U
+          && (largest == child_count
+              || SurfaceArea(binary_nodes[children[i]])
+                   > SurfaceArea(binary_nodes[children[largest]]))) {
+        largest = i;
+      }
+    }
+    if (largest == child_count) {
+      break;
+    }
+
+    const std::uint32_t opened{ children[largest] };
+    children[largest] = binary_nodes[opened].first;
+    children[child_count++] = binary_nodes[opened].first + 1U;
+  }
+
+  // Quantize the children's bounds relative to their union
+  WideBvhNode node{};
+  node.child_count = static_cast<std::uint8_t>(child_count);
+  for (std::size_t axis{ 0U }; axis < 3U; ++axis) {
+    float bounds_min{ binary_nodes[children[0]].bounds_min[axis] };
+    float bounds_max{ binary_nodes[children[0]].bounds_max[axis] };
+    for (std::size_t i{ 1U }; i < child_count; ++i) {
+      bounds_min = std::min(bounds_min, binary_nodes[children[i]].bounds_min[axis]);
+      bounds_max = std::max(bounds_max, binary_nodes[children[i]].bounds_max[axis]);
+    }
+    node.origin[axis] = bounds_min;
+
+    // Start from the power of two step just below extent / 255 and grow
+    // it until every child fits in 255 steps
+    const float extent{ bounds_max - bounds_min };
+    int exponent{ extent > 0.0F ? std::ilogb(extent / 255.0F) + 127 : 1 };
+    exponent = std::clamp(exponent, 1, 254);
+    node.exponent[axis] = static_cast<std::uint8_t>(exponent);
+    while (!QuantizeAxis(binary_nodes, children, child_count, axis, node)
+           && node.exponent[axis] < 254U) {
+      ++node.exponent[axis];
+    }
+  }
+
+  // Leaf children keep their item ranges; interior children get nodes
+  // of their own, allocated before descending so siblings stay adjacent
+  for (std::size_t i{ 0U }; i < child_count; ++i) {
+    const BvhNode& child{ binary_nodes[children[i]] };
+    if (child.count > 0U) {
+      node.child[i] = WideBvhNode::kLeafFlag
+                      | ((child.count - 1U) << WideBvhNode::kLeafCountShift)
+                      | child.first;
+    } else {
+      node.child[i] = static_cast<std::uint32_t>(nodes.size());
+      nodes.emplace_back();
+    }
+  }
+  nodes[wide_index] = node;
+
+  for (std::size_t i{ 0U }; i < child_count; ++i) {
+    if ((node.child[i] & WideBvhNode::kLeafFlag) == 0U) {
+      CollapseNode(binary_nodes, children[i], nodes, node.child[i]);
+    }
+  }
+}
+
+}  // namespace
+
+std::vector<WideBvhNode> CollapseBvh(const std::vector<BvhNode>& binary_nodes) {
+  std::vector<WideBvhNode> nodes{};
+  if (binary_nodes.empty()) {
+    return nodes;
+  }
+
+  nodes.emplace_back();
+  CollapseNode(binary_nodes, 0U, nodes, 0U);
+  return nodes;
+}
@@ -0,0 +1,129 @@
+#ifndef WIDEBVH_H
+#define WIDEBVH_H
+
+// STL
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// src
+#include "SphereBvh.h"
+
+// Compressed node of an 8-wide bounding volume hierarchy.
+//
+// Child bounds are stored as 8-bit offsets from the node's origin in
+// units of a power of two per axis, rounded outwards so the decoded boxes
+// always contain the originals. At 96 bytes for up to 8 children this is
+// less than half the size of the equivalent binary nodes, and a ray
+// visits a quarter as many of them.
+struct WideBvhNode {
+  static constexpr std::uint32_t kWidth{ 8U };
+
+  // Children referencing a range of items (spheres or clusters) rather
+  // than another node have kLeafFlag set, the item count minus one in the
+  // following bits and the first item in the rest
+  static constexpr std::uint32_t kLeafFlag{ 0x80000000U };
+  static constexpr std::uint32_t kLeafCountShift{ 27U };
+  static constexpr std::uint32_t kLeafCountMask{ 0xFU };
+  static constexpr std::uint32_t kIndexMask{ 0x07FFFFFFU };
+
+  float origin[3];
+  // Biased IEEE exponent of each axis' quantization step
+  std::uint8_t exponent[3];
+  std::uint8_t child_count;
+  std::uint8_t child_min[3][kWidth];
+  std::uint8_t child_max[3][kWidth];
+  std::uint32_t child[kWidth];
+};
+
+static_assert(sizeof(WideBvhNode) == 96U);
+
+// Converts a binary hierarchy into a wide one by pulling the largest
+// descendants of each binary node up into its wide node; leaf children
+// keep the item ranges of the binary leaves
+[[nodiscard]]
+std::vector<WideBvhNode> CollapseBvh(const std::vector<BvhNode>& binary_nodes);
+
+// Visits the leaves of a wide hierarchy hit by a ray in near to far
+// order, skipping any that start beyond nearest_distance.
+// intersect_leaf(first, count) is expected to lower nearest_distance when
+// it finds a hit.
+template <typename LeafFunction>
+void TraverseWideBvh(
+    const WideBvhNode* nodes,
+    const float* origin,
+    const float* inverse_direction,
+    float min_distance,
+    float& nearest_distance,
+    LeafFunction&& intersect_leaf) {
+  // Nodes and leaves still to visit along with the distance the ray
+  // enters them; deep enough for more than a billion items
+  struct StackEntry {
+    std::uint32_t child;
+    float entry_distance;
+  };
+  StackEntry stack[128];
+  std::size_t stack_size{ 0U };
+  stack[stack_size++] = StackEntry{ 0U, min_distance };
+
+  while (stack_size > 0U) {
+    const StackEntry entry{ stack[--stack_size] };
+    // Skip nodes behind a hit found since they were pushed
+    if (entry.entry_distance >= nearest_distance) {
+      continue;
+    }
+
+    if ((entry.child & WideBvhNode::kLeafFlag) != 0U) {
+      intersect_leaf(entry.child & WideBvhNode::kIndexMask,
+                     ((entry.child >> WideBvhNode::kLeafCountShift)
+                      & WideBvhNode::kLeafCountMask) + 1U);
+      continue;
+    }
+
+    // Move the ray into the node's quantized frame once, so each child
+    // slab costs a multiply-add
+    const WideBvhNode& node{ nodes[entry.child] };
+    float slab_offset[3]{};
+    float slab_scale[3]{};
+    for (std::size_t axis{ 0U }; axis < 3U; ++axis) {
+      const float scale{
+        std::bit_cast<float>(static_cast<std::uint32_t>(node.exponent[axis]) << 23U)
+      };
+      slab_offset[axis] = (node.origin[axis] - origin[axis]) * inverse_direction[axis];
+      slab_scale[axis] = scale * inverse_direction[axis];
+    }
+
+    // Intersect every child's box
+    StackEntry hits[WideBvhNode::kWidth];
+    std::size_t hit_count{ 0U };
+    for (std::size_t i{ 0U }; i < node.child_count; ++i) {
+      float entry_distance{ min_distance };
+      float exit_distance{ nearest_distance };
+      for (std::size_t axis{ 0U }; axis < 3U; ++axis) {
+        const float near_plane{
+          slab_offset[axis] + static_cast<float>(node.child_min[axis][i]) * slab_scale[axis]
+        };
+        const float far_plane{
+          slab_offset[axis] + static_cast<float>(node.child_max[axis][i]) * slab_scale[axis]
+        };
+        entry_distance = std::max(entry_distance, std::min(near_plane, far_plane));
+        exit_distance = std::min(exit_distance, std::max(near_plane, far_plane));
+      }
+      if (entry_distance <= exit_distance) {
+        hits[hit_count++] = StackEntry{ node.child[i], entry_distance };
+      }
+    }
+
+    // Push the farthest child first so the nearest one is visited next
+    std::sort(hits, hits + hit_count, [](const StackEntry& a, const StackEntry& b) {
+      return a.entry_distance > b.entry_distance;
+    });
+    for (std::size_t i{ 0U }; i < hit_count; ++i) {
+      stack[stack_size++] = hits[i];
+    }
+  }
+}
+
+#endif
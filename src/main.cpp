@@ -1,184 +1,406 @@
-// spdlog
-#include "spdlog/spdlog.h"
-
-// src
-#include "Application.h"
-
-int main(int argc, char* argv[]) {
-  // Create and initialize application
-  Application application{};
-  if (!application.Initialize()) {
-    spdlog::error("Editor failed to initialize.");
-    return 1;
-  }
-
-  // Run editor
-  application.Run();
-
-  return 0;
-}
-
-/*
 // STL
+#include <charconv>
 #include <chrono>
 #include <cstddef>
-#include <fstream>
-#include <iostream>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
 
 // glm
-#include "glm/common.hpp"
 #include "glm/vec3.hpp"
 
+// spdlog
+#include "spdlog/spdlog.h"
+
 // src
+#include "Application.h"
+#include "AsyncLogWriter.h"
+#include "EnvironmentMap.h"
+#include "JobSystem.h"
+#include "Kernels.h"
+#include "LogRing.h"
+#include "PagedGeometry.h"
+#include "Renderer.h"
+#include "RenderServer.h"
 #include "Scene.h"
-#include "Ray.h"
-#include "IRayTraceable.h"
+#include "SceneLoader.h"
 #include "Sphere.h"
-
-glm::vec3 ComputeRayColor(const Scene& scene, const Ray& ray) {
-  // Trace ray against all traceable objects in the scene
-  std::optional<TraceResult> trace_result{
-    scene.TraceRay(ray, 0.0F, std::numeric_limits<float>::infinity())
+#include "TextureCache.h"
+#include "TiledTexture.h"
+
+namespace {
+
+struct CommandLineOptions {
+  bool headless{ false };
+  std::optional<std::string_view> isa_override{};
+  std::optional<std::string_view> scene_path{};
+  std::optional<std::string_view> environment_path{};
+  std::size_t light_count{ 0U };
+  std::optional<std::string_view> geometry_path{};
+  std::size_t geometry_cache_bytes{ PagedGeometry::kDefaultCapacityBytes };
+  RenderSettings render_settings{};
+  CheckpointSettings checkpoint{ "image.checkpoint" };
+  bool resume{ false };
+  std::filesystem::path log_path{ "render.log" };
+  std::optional<std::pair<std::string_view, std::string_view>> texture_conversion{};
+  std::optional<std::pair<std::string_view, std::string_view>> geometry_conversion{};
+  std::optional<std::string_view> socket_path{};
+  std::size_t scene_cache_capacity{ 4U };
+};
+
+// Scenes can be large, so more than this many are unlikely to fit in memory
+constexpr std::uint64_t kMaxSceneCacheCapacity{ 1024U };
+
+// Parses an option's whole value as an integer in [min_value, max_value],
+// logging a usage error otherwise
+std::optional<std::uint64_t> ParseIntegerOption(
+    std::string_view option,
+    std::string_view text,
+    std::uint64_t min_value,
+    std::uint64_t max_value) {
+  std::uint64_t value{};
+  const std::from_chars_result result{
+    std::from_chars(text.data(), text.data() + text.size(), value)
   };
+  if (result.ec != std::errc{} || result.ptr != text.data() + text.size()
+      || value < min_value || value > max_value) {
+    spdlog::error("{} expects a whole number from {} to {}, not \"{}\".",
+                  option, min_value, max_value, text);
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::shared_ptr<Scene> CreateDefaultScene(const CommandLineOptions& options) {
+  // Scene settings
+  std::shared_ptr<Scene> scene{ std::make_shared<Scene>() };
+  scene->AddSphere(Sphere{ glm::vec3{ 0.0F, 0.0F, -1.0F }, 0.5F });
+  scene->AddSphere(Sphere{ glm::vec3{ 0.0F, -100.5F, -1.0F }, 100.0F });
+
+  // Scatter small emissive spheres over the ground
+  std::mt19937 gen{ 0U };
+  std::uniform_real_distribution dist{ 0.0F, 1.0F };
+  for (std::size_t i{ 0U }; i < options.light_count; ++i) {
+    const glm::vec3 center{
+      -10.0F + 20.0F * dist(gen), -0.45F + 0.5F * dist(gen), -1.0F - 20.0F * dist(gen)
+    };
+    const glm::vec3 emission{
+      glm::vec3{ 2.0F + 8.0F * dist(gen), 2.0F + 6.0F * dist(gen), 1.0F + 4.0F * dist(gen) }
+    };
+    scene->AddSphere(Sphere{ center, 0.05F, Material{ glm::vec3{ 0.0F }, emission } });
+  }
+
+  // Trace a sphere set too large for memory from disk if one was given
+  if (options.geometry_path.has_value()) {
+    const std::shared_ptr<PagedGeometry> geometry{
+      PagedGeometry::Open(options.geometry_path.value(), options.geometry_cache_bytes)
+    };
+    if (!geometry) {
+      return nullptr;
+    }
+    scene->AddPagedGeometry(geometry);
+    scene->AddInputFile(options.geometry_path.value());
+  }
 
-  // If anything was hit, color the ray with its impact normal
-  if (trace_result.has_value()) {
-    return 0.5F * (trace_result.value().impact_normal + glm::vec3{ 1.0F, 1.0F, 1.0F });
+  // Light the scene with an HDR environment if one was given
+  if (options.environment_path.has_value()) {
+    std::shared_ptr<EnvironmentMap> environment{
+      EnvironmentMap::Load(options.environment_path.value())
+    };
+    if (!environment) {
+      return nullptr;
+    }
+    scene->SetEnvironment(std::move(environment));
+    scene->AddInputFile(options.environment_path.value());
   }
 
-  // Otherwise, return a background color gradient
-  const float a{
-    0.5F * (ray.direction().y + 1.0F)
+  scene->Build();
+  return scene;
+}
+
+// Folds a file's location, size and modification time into hash; the
+// files a scene references can be too large to hash whole
+bool HashFileIdentity(const std::filesystem::path& path, std::uint64_t& hash) {
+  std::error_code error{};
+  const std::string canonical_path{ std::filesystem::canonical(path, error).string() };
+  const std::uintmax_t size{ error ? 0U : std::filesystem::file_size(path, error) };
+  const std::filesystem::file_time_type write_time{
+    error ? std::filesystem::file_time_type{} : std::filesystem::last_write_time(path, error)
   };
+  if (error) {
+    spdlog::error("Failed to read {}: {}.", path.string(), error.message());
+    return false;
+  }
 
-  return (1.0F - a) * glm::vec3{ 1.0F, 1.0F, 1.0F }
-         + a * glm::vec3{ 0.5F, 0.7F, 1.0F };
+  const std::int64_t write_ticks{ write_time.time_since_epoch().count() };
+  hash = HashSceneBytes(hash, canonical_path.data(), canonical_path.size());
+  hash = HashSceneBytes(hash, &size, sizeof(size));
+  hash = HashSceneBytes(hash, &write_ticks, sizeof(write_ticks));
+  return true;
 }
 
-int main(int argc, char* argv[]) {
-  // Create random number generator for antialiasing
-  std::random_device rd{};
-  std::mt19937 gen{ rd() };
-  std::uniform_real_distribution dist{ 0.0F, 1.0F };
+// Identifies the scene by the scene file's contents if there is one,
+// the options building the default scene, and the location, size and
+// modification time of every file the scene was built from, such as its
+// environment map, geometry and textures
+std::optional<std::uint64_t> ComputeSceneIdentity(
+    const CommandLineOptions& options,
+    const Scene& scene) {
+  std::uint64_t hash{ kSceneHashBasis };
+  if (options.scene_path.has_value()) {
+    const std::optional<std::uint64_t> scene_hash{
+      HashSceneFile(options.scene_path.value())
+    };
+    if (!scene_hash.has_value()) {
+      return std::nullopt;
+    }
+    hash = scene_hash.value();
+  }
 
-  // Ray tracing settings
-  constexpr size_t samples_per_pixel{ 100 };
-  constexpr float weight_per_sample{ 1.0F / static_cast<float>(samples_per_pixel) };
+  // The default scene's lights come from the options rather than a file
+  hash = HashSceneBytes(hash, &options.light_count, sizeof(options.light_count));
 
-  // Scene settings
-  Scene scene{};
-  scene.AddObject(std::make_shared<Sphere>(
-    glm::vec3{ 0.0F, 0.0F, -1.0F}, 0.5F)
-  );
-  scene.AddObject(std::make_shared<Sphere>(
-    glm::vec3{ 0.0F, -100.5F, -1.0F}, 100.0F)
-  );
-
-  // Camera settings
-  constexpr glm::vec3 camera_position{ 0.0F, 0.0F, 0.0F };
-  constexpr float focal_length{ 1.0F };
-
-  // Image settings
-  constexpr float aspect_ratio{ 16.0F / 9.0F };
-
-  constexpr size_t image_width{ 1280U };
-  constexpr size_t image_height{
-    static_cast<size_t>(static_cast<float>(image_width) / aspect_ratio)
-  };
+  // Files the scene was built from, whether named by the scene file or
+  // the options, in the order they were opened
+  for (const std::filesystem::path& input_file : scene.input_files()) {
+    if (!HashFileIdentity(input_file, hash)) {
+      return std::nullopt;
+    }
+  }
 
-  constexpr float viewport_height{ 2.0F };
-  constexpr float viewport_width{
-    viewport_height * (static_cast<float>(image_width) / static_cast<float>(image_height))
+  return hash;
+}
+
+int RunHeadlessRender(const CommandLineOptions& options) {
+  // Load the requested scene, or fall back to the built-in one
+  JobSystem jobs{};
+  const std::shared_ptr<Scene> scene{
+    options.scene_path.has_value()
+      ? LoadScene(options.scene_path.value(), &jobs, nullptr)
+      : CreateDefaultScene(options)
   };
+  if (!scene) {
+    return 1;
+  }
 
-  constexpr glm::vec3 viewport_v{ 0.0F, -viewport_height, 0.0F };
-  constexpr glm::vec3 viewport_u{ viewport_width, 0.0F, 0.0F };
+  // Checkpoints record the scene so they are only resumed with it
+  CheckpointSettings checkpoint{ options.checkpoint };
+  const std::optional<std::uint64_t> scene_identity{ ComputeSceneIdentity(options, *scene) };
+  if (!scene_identity.has_value()) {
+    return 1;
+  }
+  checkpoint.scene_identity = scene_identity.value();
 
-  constexpr glm::vec3 delta_v{ viewport_v / static_cast<float>(image_height) };
-  constexpr glm::vec3 delta_u{ viewport_u / static_cast<float>(image_width) };
+  // Continue from the last checkpoint if requested, e.g. after being
+  // preempted or to add samples to a finished image
+  Renderer renderer{ options.render_settings };
+  if (options.resume && !renderer.LoadCheckpoint(checkpoint)) {
+    return 1;
+  }
 
-  constexpr glm::vec3 viewport_upper_left_position {
-    camera_position
-    - glm::vec3{ 0.0F, 0.0F, focal_length }
-    - 0.5F * (viewport_u + viewport_v)
-  };
+  // Render and write image
+  renderer.Render(*scene, checkpoint);
+  for (const std::shared_ptr<PagedGeometry>& geometry : scene->paged_geometries()) {
+    geometry->LogStats();
+  }
+  if (scene->texture_cache()) {
+    scene->texture_cache()->LogStats();
+  }
+  if (!renderer.WriteImage("image.ppm")) {
+    return 1;
+  }
 
-  constexpr glm::vec3 upper_left_pixel_position {
-    viewport_upper_left_position
-    + 0.5F * (delta_u + delta_v)
-  };
+  return 0;
+}
 
-  // Open output image file
-  std::ofstream output_image_file{ "image.ppm" };
-  if (!output_image_file) {
-    std::cerr << "Failed to open output image file." << std::endl;
+int ConvertTexture(std::string_view input_path, std::string_view output_path) {
+  // Load source image and write it out as a tiled mip pyramid
+  std::uint32_t width{};
+  std::uint32_t height{};
+  const std::optional<std::vector<std::uint8_t>> rgb{
+    LoadPpm(input_path, width, height)
+  };
+  if (!rgb.has_value()
+      || !TiledTextureFile::Write(output_path, width, height, rgb.value())) {
     return 1;
   }
 
-  // Begin timer
-  const std::chrono::time_point start_time{ std::chrono::high_resolution_clock::now() };
+  return 0;
+}
 
-  // Write header to output image file
-  output_image_file << "P3\n" << image_width << ' ' << image_height << "\n255\n";
+int ConvertGeometry(std::string_view input_path, std::string_view output_path) {
+  // Load the scene's spheres and write them out as paged clusters
+  JobSystem jobs{};
+  const std::shared_ptr<Scene> scene{ LoadScene(input_path, &jobs, nullptr) };
+  if (!scene
+      || !PagedGeometry::Write(output_path, scene->GetSphereArrays(),
+                               scene->sphere_materials())) {
+    return 1;
+  }
 
-  // Render image by iterating over every pixel
-  for (size_t v{ 0U }; v < image_height; ++v) {
-    // Log progress
-    std::clog << "\rScanlines remaining: " << image_height - v << ' ' << std::flush;
+  return 0;
+}
 
-    for (size_t u{ 0U }; u < image_width; ++u) {
-      // Zero-initialize final color for the pixel
-      glm::vec3 pixel_color{};
+}  // namespace
 
-      // Accumulate color by iterating over subpixel samples
-      for (size_t sample{ 0U }; sample < samples_per_pixel; ++sample) {
-        // Generate a random offset within the pixel for sample
-        glm::vec3 sample_offset{ dist(gen), dist(gen), 0.0F };
+int main(int argc, char* argv[]) {
+  // Route all logging through the lock-free ring
+  InitializeLogging();
+
+  // Parse command line arguments, stopping at the first invalid one
+  CommandLineOptions options{};
+  bool valid_arguments{ true };
+  for (int i{ 1 }; valid_arguments && i < argc; ++i) {
+    const std::string_view argument{ argv[i] };
+    if (argument == "--render") {
+      options.headless = true;
+    } else if (argument == "--serve" && i + 1 < argc) {
+      options.socket_path = argv[++i];
+    } else if (argument == "--scene-cache" && i + 1 < argc) {
+      // The cache always keeps at least the scene being rendered
+      const std::optional<std::uint64_t> scene_cache_capacity{
+        ParseIntegerOption(argument, argv[++i], 1U, kMaxSceneCacheCapacity)
+      };
+      valid_arguments = scene_cache_capacity.has_value();
+      options.scene_cache_capacity = scene_cache_capacity.value_or(1U);
+    } else if (argument == "--isa" && i + 1 < argc) {
+      options.isa_override = argv[++i];
+    } else if (argument == "--scene" && i + 1 < argc) {
+      options.scene_path = argv[++i];
+    } else if (argument == "--environment" && i + 1 < argc) {
+      options.environment_path = argv[++i];
+    } else if (argument == "--lights" && i + 1 < argc) {
+      const std::optional<std::uint64_t> light_count{
+        ParseIntegerOption(argument, argv[++i], 0U, std::numeric_limits<std::uint32_t>::max())
+      };
+      valid_arguments = light_count.has_value();
+      options.light_count = light_count.value_or(0U);
+    } else if (argument == "--geometry" && i + 1 < argc) {
+      options.geometry_path = argv[++i];
+    } else if (argument == "--geometry-cache" && i + 1 < argc) {
+      // Given in MiB, which must not overflow once converted to bytes
+      const std::optional<std::uint64_t> capacity_mib{
+        ParseIntegerOption(argument, argv[++i], 1U,
+                           std::numeric_limits<std::size_t>::max() / (1024U * 1024U))
+      };
+      valid_arguments = capacity_mib.has_value();
+      options.geometry_cache_bytes = capacity_mib.value_or(1U) * 1024U * 1024U;
+    } else if (argument == "--spp" && i + 1 < argc) {
+      // Per-pixel sample counts are 32-bit
+      const std::optional<std::uint64_t> samples_per_pixel{
+        ParseIntegerOption(argument, argv[++i], 1U, std::numeric_limits<std::uint32_t>::max())
+      };
+      valid_arguments = samples_per_pixel.has_value();
+      options.render_settings.samples_per_pixel = samples_per_pixel.value_or(1U);
+    } else if (argument == "--seed" && i + 1 < argc) {
+      const std::optional<std::uint64_t> seed{
+        ParseIntegerOption(argument, argv[++i], 0U, std::numeric_limits<std::uint32_t>::max())
+      };
+      valid_arguments = seed.has_value();
+      options.render_settings.seed = static_cast<std::uint32_t>(seed.value_or(0U));
+    } else if (argument == "--pixel-order" && i + 1 < argc) {
+      const std::optional<PixelOrder> pixel_order{ ParsePixelOrder(argv[++i]) };
+      if (!pixel_order.has_value()) {
+        spdlog::error("Unknown pixel order \"{}\".", argv[i]);
+        valid_arguments = false;
+      }
+      options.render_settings.pixel_order = pixel_order.value_or(PixelOrder::kHilbert);
+    } else if (argument == "--bin-rays" && i + 1 < argc) {
+      const std::string_view bin_rays{ argv[++i] };
+      if (bin_rays != "on" && bin_rays != "off") {
+        spdlog::error("--bin-rays expects on or off, not \"{}\".", bin_rays);
+        valid_arguments = false;
+      }
+      options.render_settings.bin_secondary_rays = bin_rays == "on";
+    } else if (argument == "--checkpoint" && i + 1 < argc) {
+      options.checkpoint.path = argv[++i];
+    } else if (argument == "--checkpoint-interval" && i + 1 < argc) {
+      const std::optional<std::uint64_t> interval_seconds{
+        ParseIntegerOption(argument, argv[++i], 0U, std::numeric_limits<std::uint32_t>::max())
+      };
+      valid_arguments = interval_seconds.has_value();
+      options.checkpoint.interval = std::chrono::seconds{
+        static_cast<std::chrono::seconds::rep>(interval_seconds.value_or(0U))
+      };
+    } else if (argument == "--resume") {
+      options.resume = true;
+    } else if (argument == "--log" && i + 1 < argc) {
+      options.log_path = argv[++i];
+    } else if (argument == "--convert-texture" && i + 2 < argc) {
+      options.texture_conversion = std::pair{ argv[i + 1], argv[i + 2] };
+      i += 2;
+    } else if (argument == "--convert-geometry" && i + 2 < argc) {
+      options.geometry_conversion = std::pair{ argv[i + 1], argv[i + 2] };
+      i += 2;
+    } else {
+      spdlog::warn("Ignoring unknown argument \"{}\".", argument);
+    }
+  }
 
-        // Compute current sample position
-        const glm::vec3 sample_position{
-          upper_left_pixel_position
-          + (static_cast<float>(u) + sample_offset.x) * delta_u
-          + (static_cast<float>(v) + sample_offset.y) * delta_v
-        };
+  // Write log messages out from a background thread until the editor's
+  // Console takes over draining the ring; only headless renders and the
+  // render server log to file
+  const bool logs_to_file{ options.headless || options.socket_path.has_value() };
+  std::optional<AsyncLogWriter> log_writer{};
+  log_writer.emplace(GetLogRing(), logs_to_file ? options.log_path : std::filesystem::path{});
 
-        // Compute ray origin and direction for sample
-        const glm::vec3 sample_ray_origin{ camera_position };
-        const glm::vec3 sample_ray_direction{ sample_position - sample_ray_origin };
+  // Usage errors are logged while parsing but only written out from here
+  if (!valid_arguments) {
+    return 1;
+  }
 
-        // Construct ray for sample
-        const Ray sample_ray{ sample_ray_origin, sample_ray_direction };
+  if (options.texture_conversion.has_value()) {
+    return ConvertTexture(options.texture_conversion.value().first,
+                          options.texture_conversion.value().second);
+  }
 
-        // Compute color for ray
-        const glm::vec3 sample_ray_color{ ComputeRayColor(scene, sample_ray) };
+  // Select kernels for the host CPU before any rendering happens
+  if (!InitializeKernels(options.isa_override)) {
+    spdlog::error("Failed to select kernels.");
+    return 1;
+  }
 
-        // Accumulate color
-        pixel_color += sample_ray_color * weight_per_sample;
-      }
+  if (options.geometry_conversion.has_value()) {
+    return ConvertGeometry(options.geometry_conversion.value().first,
+                           options.geometry_conversion.value().second);
+  }
 
-      // Clamp and write pixel color to output image file
-      const int r{ static_cast<int>(255.999F * glm::clamp(pixel_color.r, 0.0F, 0.999F)) };
-      const int g{ static_cast<int>(255.999F * glm::clamp(pixel_color.g, 0.0F, 0.999F)) };
-      const int b{ static_cast<int>(255.999F * glm::clamp(pixel_color.b, 0.0F, 0.999F)) };
+  // Serve render jobs until shut down if requested
+  if (options.socket_path.has_value()) {
+    JobSystem jobs{};
+    RenderServer server{ jobs, options.scene_cache_capacity };
+    return server.Run(options.socket_path.value()) ? 0 : 1;
+  }
 
-      output_image_file << r << ' ' << g << ' ' << b << '\n';
-    }
+  // Render straight to file without the editor if requested
+  if (options.headless) {
+    return RunHeadlessRender(options);
   }
-  std::clog << "\nRender complete." << std::endl;
 
-  // Stop timer
-  const std::chrono::time_point end_time{ std::chrono::high_resolution_clock::now() };
+  // Create and initialize application
+  log_writer.reset();
+  Application application{};
+  if (!application.Initialize()) {
+    spdlog::error("Editor failed to initialize.");
+    log_writer.emplace(GetLogRing(), std::filesystem::path{});
+    return 1;
+  }
 
-  // Compute and log elapsed time
-  const std::chrono::duration<float> elapsed_time{ end_time - start_time };
-  std::cout << "Image rendered in " << elapsed_time.count() << " seconds." << std::endl;
+  // Start loading the requested scene in the background
+  if (options.scene_path.has_value()) {
+    application.LoadSceneAsync(options.scene_path.value());
+  }
 
-  // Close output image file
-  output_image_file.close();
+  // Run editor
+  application.Run();
 
   return 0;
 }
-*/
\ No newline at end of file